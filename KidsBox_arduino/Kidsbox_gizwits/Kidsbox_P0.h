@@ -0,0 +1,151 @@
+/********************************************************
+*
+* @file      [Kidsbox_P0.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*            由 tools/p0_gen 根据 Kidsbox.json 生成，请修改数据点定义后重新生成
+*
+*********************************************************/
+#ifndef _KIDSBOX_P0_H
+#define _KIDSBOX_P0_H
+
+#include "GizWire.h"
+
+/******************************************************
+* 数据点，偏移从状态区(控制区为 Attr_Flags 之后)算起
+********************************************************/
+//LED_OnOff 开启/关闭红色灯：可写
+struct Kidsbox_LED_OnOff : Pro_P0Bits<0, 0, 1, 1> {};
+//LED_Color 设定LED组合颜色：可写 0:自定义 1:黄色 2:紫色 3:粉色
+struct Kidsbox_LED_Color : Pro_P0Bits<0, 1, 2, 3> {};
+//LED_R 设定LED红色值：可写
+struct Kidsbox_LED_R : Pro_P0Value<1, uint8_t, 0, 254>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = 0;
+};
+//LED_G 设定LED绿色值：可写
+struct Kidsbox_LED_G : Pro_P0Value<2, uint8_t, 0, 254>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = 0;
+};
+//LED_B 设定LED蓝色值：可写
+struct Kidsbox_LED_B : Pro_P0Value<3, uint8_t, 0, 254>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = 0;
+};
+//Motor_Speed 设定电机转速：可写，显示值 = 原始值 * 1 + (-5)
+struct Kidsbox_Motor_Speed : Pro_P0Value<4, uint16_t, 0, 10>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = -5;
+};
+//Infrared 红外探测：只读
+struct Kidsbox_Infrared : Pro_P0Bits<6, 0, 1, 1> {};
+//Temperature 温度：只读，显示值 = 原始值 * 1 + (-13)
+struct Kidsbox_Temperature : Pro_P0Value<7, uint8_t, 0, 75>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = -13;
+};
+//Humidity 湿度：只读
+struct Kidsbox_Humidity : Pro_P0Value<8, uint8_t, 0, 100>
+{
+	static constexpr double		Ratio = 1;
+	static constexpr int32_t	Addition = 0;
+};
+//Alert_1 报警1：报警
+struct Kidsbox_Alert_1 : Pro_P0Bits<9, 0, 1, 1> {};
+//Alert_2 报警2：报警
+struct Kidsbox_Alert_2 : Pro_P0Bits<9, 1, 1, 1> {};
+//Fault_LED LED故障：故障
+struct Kidsbox_Fault_LED : Pro_P0Bits<10, 0, 1, 1> {};
+//Fault_Motor 电机故障：故障
+struct Kidsbox_Fault_Motor : Pro_P0Bits<10, 1, 1, 1> {};
+//Fault_TemHum 温湿度传感器故障：故障
+struct Kidsbox_Fault_TemHum : Pro_P0Bits<10, 2, 1, 1> {};
+//Fault_IR 红外传感器故障：故障
+struct Kidsbox_Fault_IR : Pro_P0Bits<10, 3, 1, 1> {};
+
+/******************************************************
+* 状态区：设备上报和读取回复的P0数据，共 11 字节
+* 控制区：控制命令的P0数据，1 字节 Attr_Flags 之后是与状态区相同的可写部分
+* BitsN 为按位存放的字节，括号内为其中数据点的起始位
+********************************************************/
+typedef struct
+{
+	uint8_t				Bits0;		//LED_OnOff(0), LED_Color(1-2)
+	uint8_t				LED_R;
+	uint8_t				LED_G;
+	uint8_t				LED_B;
+	be16<uint16_t>		Motor_Speed;
+	uint8_t				Bits6;		//Infrared(0)
+	uint8_t				Temperature;
+	uint8_t				Humidity;
+	uint8_t				Bits9;		//Alert_1(0), Alert_2(1)
+	uint8_t				Bits10;		//Fault_LED(0), Fault_Motor(1), Fault_TemHum(2), Fault_IR(3)
+}Kidsbox_ReadTypeDef;
+
+typedef struct
+{
+	uint8_t				Attr_Flags;		//bit n 对应 id 为 n 的可写数据点
+	uint8_t				Bits0;		//LED_OnOff(0), LED_Color(1-2)
+	uint8_t				LED_R;
+	uint8_t				LED_G;
+	uint8_t				LED_B;
+	be16<uint16_t>		Motor_Speed;
+}Kidsbox_WriteTypeDef;
+
+static_assert(sizeof(Kidsbox_ReadTypeDef) == 11, "P0 status layout");
+static_assert(sizeof(Kidsbox_WriteTypeDef) == 7, "P0 control layout");
+
+/*******************************************************************************
+* Function Name  : Kidsbox_Control
+* Description    : 按 Attr_Flags 把控制命令中设置的数据点依次交给 H 的同名静态函数
+* Input          : W:控制命令的P0数据
+* Output         : None
+* Return         : None
+* Attention		   : 按 id 顺序调用，值已限制在数据点的范围内；H 为每个可写数据点提供
+*                  static void 数据点名(类型 Value)，编译时绑定
+*******************************************************************************/
+template<typename H>
+inline void Kidsbox_Control(const Kidsbox_WriteTypeDef &W)
+{
+	const uint8_t *p = (const uint8_t *)&W + 1;
+
+	if(W.Attr_Flags & 0x01)
+	{
+		H::LED_OnOff(Kidsbox_LED_OnOff::Clamp(Kidsbox_LED_OnOff::Get(p)));
+	}
+	if(W.Attr_Flags & 0x02)
+	{
+		H::LED_Color(Kidsbox_LED_Color::Clamp(Kidsbox_LED_Color::Get(p)));
+	}
+	if(W.Attr_Flags & 0x04)
+	{
+		H::LED_R(Kidsbox_LED_R::Clamp(Kidsbox_LED_R::Get(p)));
+	}
+	if(W.Attr_Flags & 0x08)
+	{
+		H::LED_G(Kidsbox_LED_G::Clamp(Kidsbox_LED_G::Get(p)));
+	}
+	if(W.Attr_Flags & 0x10)
+	{
+		H::LED_B(Kidsbox_LED_B::Clamp(Kidsbox_LED_B::Get(p)));
+	}
+	if(W.Attr_Flags & 0x20)
+	{
+		H::Motor_Speed(Kidsbox_Motor_Speed::Clamp(Kidsbox_Motor_Speed::Get(p)));
+	}
+}
+
+#endif
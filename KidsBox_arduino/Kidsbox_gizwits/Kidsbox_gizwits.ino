@@ -20,8 +20,10 @@
 #include <ChainableLED.h>
 #include <SoftwareSerial.h>
 #include <Wire.h>
-#include <GizWits.h>
+#include <GizWitsStack.h>
+#include <GizTrace.h>
 #include <ringbuffer.h>
+#include "Kidsbox_P0.h"
 
 #include <Adafruit_NeoPixel.h>
 #ifdef __AVR__
@@ -32,6 +34,11 @@
 Adafruit_NeoPixel pixels = Adafruit_NeoPixel(NUMPIXELS, PIN, NEO_GRB + NEO_KHZ800);
 int delayval = 500; // delay for half a second
 
+//灯带逐个点亮的进度，由 NeoPixel_Poll 在主循环中推进
+uint8_t NeoPixel_Index = NUMPIXELS;
+uint32_t NeoPixel_Color;
+uint32_t NeoPixel_Time;
+
 #include "M5.h"
 
 //#define M5_VERSION
@@ -56,7 +63,6 @@ int delayval = 500; // delay for half a second
 #define   MOTOR_MAX         100
 #define   MOTOR_MAX1        -100
 #define   MOTOR_MIN         0
-#define   MOTOR_16
 
 ///DRT-UPDATE
 #define   PUMP1_PIN      8
@@ -76,62 +82,86 @@ ChainableLED leds(A5, A4, 1);
 SoftwareSerial mySerial(12, 13); // RX, TX
 #endif
 
-#ifdef  MOTOR_16
-typedef uint16_t MOTOR_T;
-#else
-typedef uint8_t MOTOR_T;
-#endif
+//P0结构和数据点由 tools/p0_gen 根据 Kidsbox.json 生成(Kidsbox_P0.h)，修改数据点时重新生成
+typedef Kidsbox_ReadTypeDef ReadTypeDef_t;
+typedef Kidsbox_WriteTypeDef WirteTypeDef_t;
+typedef Kidsbox_Motor_Speed::Type MOTOR_T;
 
+//数据点 LED_Color 的取值
 typedef enum
 {
-  SetLED_OnOff    = 0x01,
-  SetLED_Color    = 0x02,
-  SetLED_R        = 0x04,
-  SetLED_G        = 0x08,
-  SetLED_B        = 0x10,
-  SetMotor        = 0x20,
+  LED_Costom      = 0,
+  LED_Yellow      = 1,
+  LED_Purple      = 2,
+  LED_Pink        = 3,
 
-} Attr_FlagsTypeDef;
+} LED_ColorTypeDef;
 
-typedef enum
-{
-  LED_OnOff       = 0x00,
-  LED_OnOn        = 0x01,
-  LED_Costom      = 0x00,
-  LED_Yellow      = 0x02,
-  LED_Purple      = 0x04,
-  LED_Pink        = 0x06,
+WirteTypeDef_t  WirteTypeDef;
+ReadTypeDef_t ReadTypeDef;
+uint16_t ReadTypeDef_Version = 0;   //ReadTypeDef 每次更新后加1，协议栈据此判断读取回复的缓存是否过期
 
-} LED_ColorTypeDef;
+void GizWits_WiFiStatueHandle(uint16_t wifiStatue);
 
-typedef struct
+//协议栈回调，编译时绑定
+struct Kidsbox_Handler : GizWits_NoHandler
 {
-  uint8_t       LED_Cmd;
-  uint8_t       LED_R;
-  uint8_t       LED_G;
-  uint8_t       LED_B;
-  MOTOR_T       Motor;
-  uint8_t       Infrared;
-  uint8_t       Temperature;
-  uint8_t       Humidity;
-  uint8_t       Alert;
-  uint8_t       Fault;
-} ReadTypeDef_t;
+  static void WiFiStatus(uint16_t wifiStatue) { GizWits_WiFiStatueHandle(wifiStatue); }
 
-typedef struct
-{
-  uint8_t             Attr_Flags;
-  uint8_t             LED_Cmd;
-  uint8_t             LED_R;
-  uint8_t             LED_G;
-  uint8_t             LED_B;
-  MOTOR_T             Motor;
-} WirteTypeDef_t;
+  //模组读取设备状态时回复实时的 ReadTypeDef，而不是最近一次上报的状态
+  static uint8_t ReadStatus(const ReadTypeDef_t *&Status, uint16_t &Version)
+  {
+    Status = &ReadTypeDef;
+    Version = ReadTypeDef_Version;
+    return 1;
+  }
+};
 
-WirteTypeDef_t  WirteTypeDef;
-ReadTypeDef_t ReadTypeDef;
+//协议栈：帧缓冲区按 ReadTypeDef_t/WirteTypeDef_t 的长度分配，经 USART1 中断驱动与模组通信
+GizWits<ReadTypeDef_t, WirteTypeDef_t, GizUart_Transport, Kidsbox_Handler> Giz;
+
+/*************************** 主动上报属性表 ***************************
+ * 执行器状态与报警类属性变化立即上报；
+ * 温湿度按死区和最小间隔合并上报，DHT11 湿度抖动不再每2秒产生一次上报
+ *********************************************************************/
+const Pro_ReportAttrTypeDef ReportAttr[] PROGMEM =
+{
+  { Kidsbox_LED_OnOff::Offset,   Kidsbox_LED_OnOff::Size,   Report_Urgent, 0, 0     },  //LED_OnOff、LED_Color
+  { Kidsbox_LED_R::Offset,       Kidsbox_LED_R::Size,       Report_Urgent, 0, 0     },
+  { Kidsbox_LED_G::Offset,       Kidsbox_LED_G::Size,       Report_Urgent, 0, 0     },
+  { Kidsbox_LED_B::Offset,       Kidsbox_LED_B::Size,       Report_Urgent, 0, 0     },
+  { Kidsbox_Motor_Speed::Offset, Kidsbox_Motor_Speed::Size, Report_Urgent, 0, 0     },
+  { Kidsbox_Infrared::Offset,    Kidsbox_Infrared::Size,    Report_Urgent, 0, 0     },
+  { Kidsbox_Temperature::Offset, Kidsbox_Temperature::Size, Report_Normal, 1, 5000  },
+  { Kidsbox_Humidity::Offset,    Kidsbox_Humidity::Size,    Report_Normal, 3, 30000 },
+  { Kidsbox_Alert_1::Offset,     Kidsbox_Alert_1::Size,     Report_Urgent, 0, 0     },  //Alert_1、Alert_2
+  { Kidsbox_Fault_LED::Offset,   Kidsbox_Fault_LED::Size,   Report_Urgent, 0, 0     },  //Fault_*
+};
 void GizWits_GatherSensorData(void);
 void GizWits_ControlDeviceHandle(void);
+
+/*************************** 控制命令的执行目标 ***************************
+ * 一帧控制命令可同时设置多个属性(如R/G/B)。先按全部属性标志算出最终状态，
+ * 再对每个执行器提交一次，灯带不会因三个颜色分量而连续刷新三遍。
+ *********************************************************************/
+typedef struct
+{
+  uint8_t       Pixel;        //灯带需要更新为 R/G/B
+  uint8_t       R;
+  uint8_t       G;
+  uint8_t       B;
+  uint8_t       Motor;        //电机需要更新为 ReadTypeDef.Motor_Speed
+  uint8_t       ScreenX;
+  const char    *Screen;      //屏幕显示的表情，NULL:不变
+} Control_TargetTypeDef;
+
+void Control_SetPixel(Control_TargetTypeDef *t, uint8_t R, uint8_t G, uint8_t B)
+{
+  t->Pixel = 1;
+  t->R = R;
+  t->G = G;
+  t->B = B;
+}
 void Motor_status(MOTOR_T motor_speed);
 
 /*******************************************************
@@ -338,6 +368,13 @@ char gokit_keydown(void)
 
 }
 
+#if (GIZ_TRACE == 1)
+void Trace_Put(uint8_t value)
+{
+  mySerial.write(value);
+}
+#endif
+
 void KEY_Handle(void)
 {
   /*  长按是指按住按键3s以上   */
@@ -354,7 +391,7 @@ void KEY_Handle(void)
       mySerial.println(F("KEY1_LONG_PRESS ,Wifi Reset"));
 #endif
       //LED_RGB_Control(0, 10, 0);
-      GizWits_D2WResetCmd();
+      Giz.D2WResetCmd();
       break;
     case KEY2_SHORT_PRESS:
 #if (DEBUG==1)
@@ -362,7 +399,7 @@ void KEY_Handle(void)
 #endif
       //Soft AP mode, RGB red
       LED_RGB_Control(10, 0, 0);
-      GizWits_D2WConfigCmd(SoftAp_Mode);
+      Giz.D2WConfigCmd(SoftAp_Mode);
       NetConfigureFlag = 1;
       break;
     case KEY2_LONG_PRESS:
@@ -371,7 +408,7 @@ void KEY_Handle(void)
 #endif
       //AirLink mode, RGB green
       LED_RGB_Control(0, 10, 0);
-      GizWits_D2WConfigCmd(AirLink_Mode);
+      Giz.D2WConfigCmd(AirLink_Mode);
       NetConfigureFlag = 1;
       break;
     default:
@@ -381,14 +418,14 @@ void KEY_Handle(void)
   M5_key_value = M5.GetKey();
   if(M5_key_value &1)
   {
-    GizWits_D2WConfigCmd(SoftAp_Mode);
+    Giz.D2WConfigCmd(SoftAp_Mode);
     NetConfigureFlag = 1;
     M5.PutS(16,24,"(^o^)");
  }
   else if(M5_key_value &2)
   { 
     //AirLink mode, RGB green
-    GizWits_D2WConfigCmd(AirLink_Mode);
+    Giz.D2WConfigCmd(AirLink_Mode);
     NetConfigureFlag = 1;
     char * show_str = "-____-";
     M5.PutS_2X(16,24,show_str);
@@ -397,6 +434,10 @@ void KEY_Handle(void)
   {
     char * show_str = "(*@^@*)";
     M5.PutS_2X(16,24,show_str);
+#if (GIZ_TRACE == 1)
+    //导出最近的串口收发记录，用 tools/trace_replay 回放；由 MessageHandle 在空闲时分段输出
+    GizTrace_DumpStart(Trace_Put);
+#endif
   }
         
 }
@@ -413,9 +454,7 @@ void GizWits_WiFiStatueHandle(uint16_t wifiStatue)
 {
   if (((wifiStatue & Wifi_ConnClouds) == Wifi_ConnClouds) && (NetConfigureFlag == 1) ) //&& (NetConfigureFlag == 1)
   {
-#if(DEBUG==1)
-    mySerial.println("W2M->Wifi_ConnClouds");
-#endif
+    GIZ_LOG(Log_NetConfigDone);
     NetConfigureFlag = 0;
     ///NeoPixel_RGB(0, 0, 0);
   }
@@ -451,23 +490,42 @@ void GoKit_Init()
   //电机初始
   Motor_Init();
   memset(&ReadTypeDef, 0, sizeof(ReadTypeDef));
-  ReadTypeDef.Motor = exchangeBytes(5);//“Motor_Speed”默认上报值应该是5
+  ReadTypeDef.Motor_Speed = 5;//“Motor_Speed”默认上报值应该是5
+  ReadTypeDef_Version++;
   memset(&WirteTypeDef, 0, sizeof(WirteTypeDef));
-  GizWits_init(sizeof(ReadTypeDef_t));
+  Giz.Init();
+  Giz.SetReportAttr(ReportAttr, sizeof(ReportAttr) / sizeof(ReportAttr[0]));
 }
 
+/*******************************************************
+ *    function      : NeoPixel_RGB
+ *    Description   : 开始把灯带逐个点亮为指定颜色，立即返回
+ *                    动画进行中再次调用时从第一个像素按新颜色重新开始
+ *    return        : none
+******************************************************/
 void NeoPixel_RGB(int R, int G, int B)
 {
-  for(int i=0;i<NUMPIXELS;i++){
-
-    // pixels.Color takes RGB values, from 0,0,0 up to 255,255,255
-    pixels.setPixelColor(i, pixels.Color(R,G,B)); // Moderately bright green color.
-
-    pixels.show(); // This sends the updated pixel color to the hardware.
-
-    delay(delayval); // Delay for a period of time (in milliseconds).
+  // pixels.Color takes RGB values, from 0,0,0 up to 255,255,255
+  NeoPixel_Color = pixels.Color(R, G, B);
+  NeoPixel_Index = 0;
+  NeoPixel_Time = millis() - delayval;
+}
 
+/*******************************************************
+ *    function      : NeoPixel_Poll
+ *    Description   : 主循环中调用，每 delayval 毫秒点亮一个像素
+ *    return        : none
+******************************************************/
+void NeoPixel_Poll(void)
+{
+  if (NeoPixel_Index >= NUMPIXELS || (uint32_t)(millis() - NeoPixel_Time) < (uint32_t)delayval)
+  {
+    return;
   }
+  NeoPixel_Time = millis();
+  pixels.setPixelColor(NeoPixel_Index, NeoPixel_Color);
+  pixels.show(); // This sends the updated pixel color to the hardware.
+  NeoPixel_Index++;
 }
 
 void setup()
@@ -498,166 +556,182 @@ void setup()
 
 void loop()
 {
-  uint8_t ret = 0;
-  uint8_t buf[256];
-
   KEY_Handle();
-  ret = GizWits_MessageHandle(buf, sizeof(WirteTypeDef_t));
-  if (ret == 0)
+  //协议栈收到控制命令后立即回复ACK并放入控制队列，这里不等待执行器
+  Giz.MessageHandle();
+  NeoPixel_Poll();
+  //每次循环都取出控制命令，P0数据写入 WirteTypeDef；
+  //灯带动画进行中收到新颜色时由 NeoPixel_RGB 按新颜色重新开始，电机和屏幕不必等待动画
+  if (Giz.ControlGet(WirteTypeDef))
   {
-    memcpy((uint8_t *)&WirteTypeDef, buf, sizeof(WirteTypeDef_t));
     GizWits_ControlDeviceHandle();
-    GizWits_DevStatusUpgrade((uint8_t *)&ReadTypeDef, 10 * 60 * 1000, 1, NetConfigureFlag);
+    Giz.DevStatusUpgrade(ReadTypeDef, 10 * 60 * 1000, 1, NetConfigureFlag);
   }
   if (gaterSensorFlag != 0)
   {
     GizWits_GatherSensorData();
     gaterSensorFlag = 0;
   }
-  GizWits_DevStatusUpgrade((uint8_t *)&ReadTypeDef, 10 * 60 * 1000, 0, NetConfigureFlag);
+  Giz.DevStatusUpgrade(ReadTypeDef, 10 * 60 * 1000, 0, NetConfigureFlag);
 
 }
 
-void GizWits_ControlDeviceHandle(void)
+/*************************** 控制命令中各数据点的处理 ***************************
+ * 由 Kidsbox_Control 按 Attr_Flags 依次调用，值已限制在数据点的范围内。
+ * 只算出执行目标 t 并更新上报状态 ReadTypeDef，不操作执行器
+ *********************************************************************/
+struct Control_Attr
 {
-  if ( (WirteTypeDef.Attr_Flags & (1 << 0)) == (1 << 0))
-  {
-    if (Set_LedStatus != 1)
-    {
-      if (WirteTypeDef.LED_Cmd == LED_OnOff)
-      {
-        NeoPixel_RGB(0, 0, 0);
-        ReadTypeDef.LED_Cmd = LED_OnOff;
-#if(DEBUG==1)
-        mySerial.print(F("SetLED_Off")); mySerial.println("");
-#endif
-      }
-      if (WirteTypeDef.LED_Cmd == LED_OnOn)
-      {
-        ReadTypeDef.LED_Cmd = LED_OnOn;
-        NeoPixel_RGB(254, 0, 0);
-#if(DEBUG==1)
-        mySerial.print(F("SetLED_On")); mySerial.println("");
-#endif
-      }
-    }
+  static Control_TargetTypeDef *t;
 
-  }
-  if ( (WirteTypeDef.Attr_Flags & (1 << 1)) == (1 << 1))
+  static void LED_OnOff(uint8_t Value)
   {
-    if (WirteTypeDef.LED_Cmd == LED_Costom)
+    if (Set_LedStatus == 1)
     {
-      ReadTypeDef.LED_Cmd = LED_Costom;
-      ReadTypeDef.LED_R = 0;
-      ReadTypeDef.LED_G = 0;
-      ReadTypeDef.LED_B = 0;
-      Set_LedStatus = 0;
-      NeoPixel_RGB(0, 0, 0);
-#if(DEBUG==1)
-      mySerial.print(F("SetLED LED_Costom")); mySerial.println("");
-#endif
+      return;
     }
-    if (WirteTypeDef.LED_Cmd == LED_Yellow)
+    Pro_P0Set<Kidsbox_LED_OnOff>(ReadTypeDef, Value);
+    GIZ_LOG1(Log_CtrlLedOnOff, Value);
+    if (Value == 0)
     {
-      Set_LedStatus = 1;
-      ReadTypeDef.LED_Cmd = LED_Yellow;
-      ReadTypeDef.LED_R = 254;
-      ReadTypeDef.LED_G = 254;
-      ReadTypeDef.LED_B = 0;
-      
-      M5.ClearScreen();
-      M5.PutS_2X(12,20, "-____-");
-  
-      NeoPixel_RGB(254, 254, 0);
-#if(DEBUG==1)
-      mySerial.print(F("SetLED LED_Yellow")); mySerial.println("");
-#endif
+      Control_SetPixel(t, 0, 0, 0);
     }
-
-    if (WirteTypeDef.LED_Cmd == LED_Purple)
+    else
     {
-      ReadTypeDef.LED_Cmd = LED_Purple;
-      ReadTypeDef.LED_R = 254;
-      ReadTypeDef.LED_G = 0;
-      ReadTypeDef.LED_B = 70;
-      Set_LedStatus = 1;
-      
-      M5.ClearScreen();
-      M5.PutS_2X(20,20,"(+_+)?");
-            
-      NeoPixel_RGB(254, 0, 70);
-#if(DEBUG==1)
-      mySerial.print(F("SetLED LED_Purple")); mySerial.println("");
-#endif
+      Control_SetPixel(t, 254, 0, 0);
     }
-    if (WirteTypeDef.LED_Cmd == LED_Pink)
+  }
+
+  static void LED_Color(uint8_t Value)
+  {
+    Pro_P0Set<Kidsbox_LED_Color>(ReadTypeDef, Value);
+    GIZ_LOG1(Log_CtrlLedColor, Value);
+    switch (Value)
     {
-      ReadTypeDef.LED_Cmd = LED_Pink;
-      ReadTypeDef.LED_R = 238;
-      ReadTypeDef.LED_G = 30;
-      ReadTypeDef.LED_B = 30;
-      Set_LedStatus = 1;
-      
-      M5.ClearScreen();
-      M5.PutS_2X(24,20,"(T_T)");
-            
-      NeoPixel_RGB(238 , 30 , 30);
-#if(DEBUG==1)
-      mySerial.print(F("SetLED LED_Pink")); mySerial.println("");
-#endif
+      case LED_Costom:
+        ReadTypeDef.LED_R = 0;
+        ReadTypeDef.LED_G = 0;
+        ReadTypeDef.LED_B = 0;
+        Set_LedStatus = 0;
+        Control_SetPixel(t, 0, 0, 0);
+        break;
+      case LED_Yellow:
+        Set_LedStatus = 1;
+        ReadTypeDef.LED_R = 254;
+        ReadTypeDef.LED_G = 254;
+        ReadTypeDef.LED_B = 0;
+        t->ScreenX = 12;
+        t->Screen = "-____-";
+        Control_SetPixel(t, 254, 254, 0);
+        break;
+      case LED_Purple:
+        ReadTypeDef.LED_R = 254;
+        ReadTypeDef.LED_G = 0;
+        ReadTypeDef.LED_B = 70;
+        Set_LedStatus = 1;
+        t->ScreenX = 20;
+        t->Screen = "(+_+)?";
+        Control_SetPixel(t, 254, 0, 70);
+        break;
+      default:
+        ReadTypeDef.LED_R = 238;
+        ReadTypeDef.LED_G = 30;
+        ReadTypeDef.LED_B = 30;
+        Set_LedStatus = 1;
+        t->ScreenX = 24;
+        t->Screen = "(T_T)";
+        Control_SetPixel(t, 238, 30, 30);
+        break;
     }
   }
-  if ( (WirteTypeDef.Attr_Flags & (1 << 2)) == (1 << 2))
+
+  static void LED_R(uint8_t Value)
   {
     if (Set_LedStatus != 1)
     {
-      ReadTypeDef.LED_R = WirteTypeDef.LED_R;
-#if(DEBUG==1)
-      mySerial.print(F("W2D Control LED_R = ")); mySerial.print(WirteTypeDef.LED_R, HEX); mySerial.println("");
-#endif
-      NeoPixel_RGB(ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
+      ReadTypeDef.LED_R = Value;
+      GIZ_LOG1(Log_CtrlLedR, Value);
+      Control_SetPixel(t, ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
     }
-
   }
-  if ( (WirteTypeDef.Attr_Flags & (1 << 3)) == (1 << 3))
+
+  static void LED_G(uint8_t Value)
   {
     if (Set_LedStatus != 1)
     {
-      ReadTypeDef.LED_G = WirteTypeDef.LED_G;
-#if(DEBUG==1)
-      mySerial.print(F("W2D Control LED_G = ")); mySerial.print(WirteTypeDef.LED_G, HEX); mySerial.println("");
-#endif
-      NeoPixel_RGB(ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
+      ReadTypeDef.LED_G = Value;
+      GIZ_LOG1(Log_CtrlLedG, Value);
+      Control_SetPixel(t, ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
     }
-
   }
-  if ( (WirteTypeDef.Attr_Flags & (1 << 4)) == (1 << 4))
+
+  static void LED_B(uint8_t Value)
   {
     if (Set_LedStatus != 1)
     {
-      ReadTypeDef.LED_B = WirteTypeDef.LED_B;
-#if(DEBUG==1)
-      mySerial.print(F("W2D Control LED_B = ")); mySerial.print(WirteTypeDef.LED_B, HEX); mySerial.println("");
-#endif
-      NeoPixel_RGB(ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
+      ReadTypeDef.LED_B = Value;
+      GIZ_LOG1(Log_CtrlLedB, Value);
+      Control_SetPixel(t, ReadTypeDef.LED_R, ReadTypeDef.LED_G, ReadTypeDef.LED_B);
     }
+  }
 
+  static void Motor_Speed(MOTOR_T Value)
+  {
+    ReadTypeDef.Motor_Speed = Value;
+    GIZ_LOG1(Log_CtrlMotor, Value);
+    t->Motor = 1;
   }
-  if ( (WirteTypeDef.Attr_Flags & (1 << 5)) == (1 << 5))
+};
+Control_TargetTypeDef *Control_Attr::t;
+
+/*******************************************************************************
+* Function Name  : Control_Decode
+* Description    : 按一帧控制命令的全部属性标志算出各执行器的最终状态，
+*                  同时更新上报状态 ReadTypeDef，不操作执行器
+* Input          : None
+* Output         : t:执行目标
+* Return         : None
+* Attention      : 数据点按 id 顺序处理，与原来逐项执行时的先后关系相同
+*******************************************************************************/
+void Control_Decode(Control_TargetTypeDef *t)
+{
+  memset(t, 0, sizeof(*t));
+  Control_Attr::t = t;
+  Kidsbox_Control<Control_Attr>(WirteTypeDef);
+  ReadTypeDef_Version++;
+}
+
+/*******************************************************************************
+* Function Name  : Control_Commit
+* Description    : 把执行目标提交给执行器，每个执行器最多操作一次
+* Input          : t:执行目标
+* Output         : None
+* Return         : None
+* Attention      : 灯带只启动一次逐个点亮的动画，由 NeoPixel_Poll 完成
+*******************************************************************************/
+void Control_Commit(const Control_TargetTypeDef *t)
+{
+  if (t->Screen != NULL)
   {
-    ReadTypeDef.Motor = WirteTypeDef.Motor;
-#ifdef MOTOR_16
-#if(DEBUG==1)
-    mySerial.print(F("W2D Control Motor = ")); mySerial.print(exchangeBytes(WirteTypeDef.Motor), HEX); mySerial.println("");
-#endif
-    Motor_status(exchangeBytes(WirteTypeDef.Motor));
-#else
-#if(DEBUG==1)
-    mySerial.print(F("W2D Control Motor = ")); mySerial.print(exchangeBytes(WirteTypeDef.Motor), HEX); mySerial.println("");
-#endif
-    Motor_status(WirteTypeDef.Motor);
-#endif
+    M5.ClearScreen();
+    M5.PutS_2X(t->ScreenX, 20, (char *)t->Screen);
   }
+  if (t->Pixel)
+  {
+    NeoPixel_RGB(t->R, t->G, t->B);
+  }
+  if (t->Motor)
+  {
+    Motor_status(ReadTypeDef.Motor_Speed);
+  }
+}
+
+void GizWits_ControlDeviceHandle(void)
+{
+  Control_TargetTypeDef target;
+
+  Control_Decode(&target);
+  Control_Commit(&target);
 }
 
 /*******************************************************************************
@@ -672,12 +746,13 @@ void GizWits_GatherSensorData(void)
 {
   uint8_t curTem, curHum;
 
-  ReadTypeDef.Infrared = IR_Handle();
+  Pro_P0Set<Kidsbox_Infrared>(ReadTypeDef, IR_Handle());
   DHT11_Read_Data(&curTem, &curHum);
-  ReadTypeDef.Temperature = (curTem + lastTem) / 2;
-  ReadTypeDef.Humidity = (curHum + lastHum) / 2;
-  ReadTypeDef.Temperature = ReadTypeDef.Temperature + 13;//Temperature Data Correction
+  //读取失败时 DHT11 的值超出数据点范围，写入时被限制住
+  Pro_P0Set<Kidsbox_Temperature>(ReadTypeDef, (curTem + lastTem) / 2 - Kidsbox_Temperature::Addition);
+  Pro_P0Set<Kidsbox_Humidity>(ReadTypeDef, (curHum + lastHum) / 2);
   lastTem = curTem;
   lastHum = curHum;
+  ReadTypeDef_Version++;
 }
 
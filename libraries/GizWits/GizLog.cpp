@@ -0,0 +1,221 @@
+/********************************************************
+*
+* @file      [GizLog.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#include "GizLog.h"
+
+#if (DEBUG == 1)
+
+#define LOG_HEAD_LEN		4		//起始字节、编号、时间
+#define LOG_MAX_LEN			(LOG_HEAD_LEN + 2 * 3)	//最多3个参数
+#define LOG_SYNC_GAP		0x8000	//超过此间隔插入完整时间，保证解码时16位时间可以展开
+
+//各格式的参数个数
+#define GIZ_LOG_FMT(name, num, fmt)		num,
+static const uint8_t Log_ArgNum[Log_Num] PROGMEM =
+{
+#include "GizLogFmt.h"
+};
+#undef GIZ_LOG_FMT
+
+#if (GIZ_LOG_TEXT == 1)
+#define GIZ_LOG_FMT(name, num, fmt)		static const char name##_Fmt[] PROGMEM = fmt;
+#include "GizLogFmt.h"
+#undef GIZ_LOG_FMT
+
+#define GIZ_LOG_FMT(name, num, fmt)		name##_Fmt,
+static const char * const Log_Fmt[Log_Num] PROGMEM =
+{
+#include "GizLogFmt.h"
+};
+#undef GIZ_LOG_FMT
+
+static uint32_t log_drain_time = 0;		//已输出记录的完整时间，用于展开16位时间
+#endif
+
+static RingBuffer<GIZ_LOG_SIZE> log_ring;
+static uint16_t log_lost = 0;			//缓冲区满时丢弃的记录数
+static uint32_t log_time = 0;			//最近写入的记录的时间
+
+//在栈上组好一条记录后整条写入，空间不足时整条放弃
+static uint8_t Log_Put(uint8_t Id, uint16_t *Arg, uint32_t Now)
+{
+	uint8_t num = pgm_read_byte(&Log_ArgNum[Id]);
+	uint8_t rec[LOG_MAX_LEN];
+	uint8_t len = LOG_HEAD_LEN;
+	uint8_t i;
+
+	rec[0] = GIZ_LOG_SYNC;
+	rec[1] = Id;
+	rec[2] = (uint8_t)Now;
+	rec[3] = (uint8_t)(Now >> 8);
+	for(i = 0; i < num; i++)
+	{
+		rec[len++] = (uint8_t)Arg[i];
+		rec[len++] = (uint8_t)(Arg[i] >> 8);
+	}
+	if(rb_write(&log_ring, rec, len) == 0)
+	{
+		return 0;
+	}
+	log_time = Now;
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : GizLog_Write
+* Description    : 写入一条日志，参数个数由格式表决定，多余的参数忽略
+* Input          : Id:格式编号； A/B/C:参数
+* Output         : None
+* Return         : None
+* Attention		   : 缓冲区满时丢弃并计数，腾出空间后先补一条 Log_Lost
+*******************************************************************************/
+void GizLog_Write(uint8_t Id, uint16_t A, uint16_t B, uint16_t C)
+{
+	uint16_t arg[3];
+	uint32_t now = SystemTimeCount;
+
+	if(now - log_time >= LOG_SYNC_GAP)
+	{
+		arg[0] = (uint16_t)(now >> 16);
+		arg[1] = (uint16_t)now;
+		if(Log_Put(Log_Time, arg, now) == 0)
+		{
+			log_lost++;
+			return;
+		}
+	}
+	if(log_lost != 0)
+	{
+		arg[0] = log_lost;
+		if(Log_Put(Log_Lost, arg, now) == 0)
+		{
+			log_lost++;
+			return;
+		}
+		log_lost = 0;
+	}
+
+	arg[0] = A;
+	arg[1] = B;
+	arg[2] = C;
+	if(Log_Put(Id, arg, now) == 0)
+	{
+		log_lost++;
+	}
+}
+
+#if (GIZ_LOG_TEXT == 1)
+static void Log_PrintNum(uint32_t Value, uint8_t Base)
+{
+	char digit[11];
+	uint8_t n = 0;
+
+	do
+	{
+		digit[n++] = "0123456789ABCDEF"[Value % Base];
+		Value /= Base;
+	}while(Value != 0);
+	while(n > 0)
+	{
+		mySerial.write(digit[--n]);
+	}
+}
+
+//按 PROGMEM 中的格式输出一行
+static void Log_PrintText(uint8_t Id, uint16_t Time, const uint16_t *Arg)
+{
+	const char *fmt = (const char *)pgm_read_ptr(&Log_Fmt[Id]);
+	char c;
+
+	log_drain_time += (uint16_t)(Time - (uint16_t)log_drain_time);
+	if(Id == Log_Time)
+	{
+		log_drain_time = ((uint32_t)Arg[0] << 16) | Arg[1];
+	}
+	mySerial.write('[');
+	Log_PrintNum(log_drain_time, 10);
+	mySerial.write(']');
+	mySerial.write(' ');
+	while((c = pgm_read_byte(fmt++)) != 0)
+	{
+		if(c != '%')
+		{
+			mySerial.write(c);
+			continue;
+		}
+		switch(c = pgm_read_byte(fmt++))
+		{
+			case 'u':
+				Log_PrintNum(*Arg++, 10);
+				break;
+			case 'x':
+				Log_PrintNum(*Arg++, 16);
+				break;
+			case 'L':
+				Log_PrintNum(((uint32_t)Arg[0] << 16) | Arg[1], 10);
+				Arg += 2;
+				break;
+			case 0:
+				fmt--;
+				break;
+			default:
+				mySerial.write(c);
+				break;
+		}
+	}
+	mySerial.write('\r');
+	mySerial.write('\n');
+}
+#endif
+
+/*******************************************************************************
+* Function Name  : GizLog_Drain
+* Description    : 空闲时输出一条日志
+* Input          : Idle:1 协议栈的接收缓冲区已取空且发送队列已发完
+* Output         : None
+* Return         : None
+* Attention		   : 由协议栈的 MessageHandle 每次调用；有未处理的接收字节或发送未完成时不输出
+*******************************************************************************/
+void GizLog_Drain(uint8_t Idle)
+{
+	uint8_t rec[LOG_MAX_LEN];
+	uint8_t num;
+	uint8_t i;
+
+	if(rb_can_read(&log_ring) == 0 || Idle == 0)
+	{
+		return;
+	}
+
+	rb_read(&log_ring, rec, LOG_HEAD_LEN);
+	num = pgm_read_byte(&Log_ArgNum[rec[1]]);
+	rb_read(&log_ring, rec + LOG_HEAD_LEN, 2 * num);
+#if (GIZ_LOG_TEXT == 1)
+	{
+		uint16_t arg[3];
+
+		for(i = 0; i < num; i++)
+		{
+			arg[i] = rec[LOG_HEAD_LEN + 2 * i] | ((uint16_t)rec[LOG_HEAD_LEN + 2 * i + 1] << 8);
+		}
+		Log_PrintText(rec[1], rec[2] | ((uint16_t)rec[3] << 8), arg);
+	}
+#else
+	for(i = 0; i < LOG_HEAD_LEN + 2 * num; i++)
+	{
+		mySerial.write(rec[i]);
+	}
+#endif
+}
+
+#endif
@@ -0,0 +1,64 @@
+/********************************************************
+*
+* @file      [GizLog.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZLOG_H
+#define _GIZLOG_H
+
+#include "GizWits.h"
+
+/******************************************************
+* 延迟输出的调试日志
+* 调用处只把格式编号、时间和最多3个16位参数写入RAM环形缓冲区，
+* GizLog_Drain 在空闲时(由协议栈实例判断接收缓冲区为空、发送队列已发完)每次向 mySerial 输出一条，
+* 不再在协议处理中逐字节 print，SoftwareSerial 长时间关中断不会再打乱收发时序。
+* 缓冲区满时丢弃新的记录并计数，之后补一条 Log_Lost。
+*
+* GIZ_LOG_TEXT 为0时输出二进制记录，用 tools/log_decode 还原为文本：
+*   0xA5 | 编号 | 时间(ms低16位，低位在前) | 参数(每个2字节，低位在前)
+*   参数个数由格式表给出；相邻记录间隔超过32秒时先插入一条 Log_Time 给出完整时间。
+* GIZ_LOG_TEXT 为1时在设备上按 PROGMEM 中的格式直接输出文本行，便于用串口监视器查看。
+*
+* 只能在主循环中调用，不能在中断里调用。DEBUG 不为1时全部编译为空。
+********************************************************/
+#ifndef GIZ_LOG_TEXT
+#define GIZ_LOG_TEXT		0
+#endif
+#ifndef GIZ_LOG_SIZE
+#define GIZ_LOG_SIZE		128		//日志缓冲区大小，必须是2的幂，最大128
+#endif
+#define GIZ_LOG_SYNC		0xA5	//二进制记录的起始字节
+
+#define GIZ_LOG_FMT(name, num, fmt)		name,
+typedef enum
+{
+#include "GizLogFmt.h"
+	Log_Num,
+}GizLog_IdTypeDef;
+#undef GIZ_LOG_FMT
+
+#if (DEBUG == 1)
+#define GIZ_LOG(id)					GizLog_Write(id, 0, 0, 0)
+#define GIZ_LOG1(id, a)				GizLog_Write(id, a, 0, 0)
+#define GIZ_LOG2(id, a, b)			GizLog_Write(id, a, b, 0)
+#define GIZ_LOG3(id, a, b, c)		GizLog_Write(id, a, b, c)
+void GizLog_Write(uint8_t Id, uint16_t A, uint16_t B, uint16_t C);
+void GizLog_Drain(uint8_t Idle);
+#else
+#define GIZ_LOG(id)
+#define GIZ_LOG1(id, a)
+#define GIZ_LOG2(id, a, b)
+#define GIZ_LOG3(id, a, b, c)
+#define GizLog_Drain(Idle)
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+/********************************************************
+*
+* @file      [GizLogFmt.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+
+/******************************************************
+* 日志格式表，由 GizLog.h/GizLog.cpp 及主机解码器 tools/log_decode 共同包含，
+* 因此没有头文件保护。包含前定义 GIZ_LOG_FMT(编号, 参数个数, 格式)。
+* 格式中 %u:十进制， %x:十六进制， %L:与下一个参数合成32位十进制(高16位在前)。
+* 只能在末尾追加新项，已有编号不能改变，否则旧的日志无法解码。
+********************************************************/
+GIZ_LOG_FMT(Log_Time,			2, "-- time %L ms")
+GIZ_LOG_FMT(Log_Lost,			1, "-- %u log records lost")
+GIZ_LOG_FMT(Log_RxFrame,		3, "GAgentToMCU: cmd %x sn %u len %u")
+GIZ_LOG_FMT(Log_TxFrame,		3, "MCU        : cmd %x sn %u len %u")
+GIZ_LOG_FMT(Log_Resend,			2, "Resend ACK --> SN %x / Num %u")
+GIZ_LOG_FMT(Log_GiveUp,			0, "Give up Resend!")
+GIZ_LOG_FMT(Log_AckOk,			1, "ACK: SUCCESS! ... %u ms")
+GIZ_LOG_FMT(Log_AckLate,		1, "ACK: SUCCESS--but--Time out! ... %u ms")
+GIZ_LOG_FMT(Log_AckWindowFull,	1, "ACK window full, drop SN %x")
+GIZ_LOG_FMT(Log_ResetDevice,	0, "W2D_RequestResetDevice...")
+GIZ_LOG_FMT(Log_ErrorSent,		1, "Error : %x")
+GIZ_LOG_FMT(Log_ErrorAck,		1, "ACK : Error %x OK")
+GIZ_LOG_FMT(Log_Report10Min,	0, "10 minutes regular reporting")
+GIZ_LOG_FMT(Log_RamBudget,		2, "GizWits RAM %u of %u bytes")
+GIZ_LOG_FMT(Log_CtrlBusy,		1, "Control queue full, no ACK for SN %x")
+GIZ_LOG_FMT(Log_CtrlDup,		1, "Duplicate control SN %x, ACK only")
+GIZ_LOG_FMT(Log_Link,			1, "Cloud link %u")
+GIZ_LOG_FMT(Log_StreamRx,		3, "Stream rx: sn %u len %u ok %u")
+GIZ_LOG_FMT(Log_CtrlLedOnOff,	1, "W2D Control LED_OnOff = %u")
+GIZ_LOG_FMT(Log_CtrlLedColor,	1, "W2D Control LED_Color = %u")
+GIZ_LOG_FMT(Log_CtrlLedR,		1, "W2D Control LED_R = %x")
+GIZ_LOG_FMT(Log_CtrlLedG,		1, "W2D Control LED_G = %x")
+GIZ_LOG_FMT(Log_CtrlLedB,		1, "W2D Control LED_B = %x")
+GIZ_LOG_FMT(Log_CtrlMotor,		1, "W2D Control Motor = %x")
+GIZ_LOG_FMT(Log_NetConfigDone,	0, "W2M->Wifi_ConnClouds")
@@ -0,0 +1,165 @@
+/********************************************************
+*
+* @file      [GizStream.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZSTREAM_H
+#define _GIZSTREAM_H
+
+#include "GizUart.h"
+
+/******************************************************
+* 协议栈 GizWits<> 的传输策略：Arduino 串口对象
+*   GizStream_Transport<SoftwareSerial, mySerial>
+*   GizStream_Transport<HardwareSerial, Serial1>	(需在 GizUart.h 中把 GIZ_UART 设为0)
+* Port 只需提供 begin/available/read/write，主机上也可以是任意同名接口的类。
+* 发送时在调用内逐字节写出并完成0xFF转义，返回后各分段即可重用；
+* 发送完成回调仍推迟到 Poll 中调用，与 GizUart_Transport 的时序一致。
+* 接收由 Port 自己的缓冲区完成，溢出由 Port 处理，RxOverflow 恒为0。
+* 每个 Port 对象对应一份独立的静态状态，可以与 GizUart_Transport 的实例同时使用。
+********************************************************/
+typedef struct
+{
+	GizUart_TxDoneFunc		Done;
+	void					*Arg;
+}GizStream_DoneTypeDef;
+
+template<typename Port, Port &Serial>
+struct GizStream_Transport
+{
+	static constexpr uint16_t RamSize = GIZ_TX_QUEUE_LEN * sizeof(GizStream_DoneTypeDef) + 2;
+
+	static GizStream_DoneTypeDef	Done_Queue[GIZ_TX_QUEUE_LEN];	//已写出、尚未通知的帧
+	static uint8_t					Done_Tail;
+	static uint8_t					Done_Head;
+
+	static void Init(uint32_t baud)
+	{
+		Serial.begin(baud);
+		Done_Tail = Done_Head = 0;
+	}
+
+	static uint8_t Read(uint8_t *value)
+	{
+		if(Serial.available() <= 0)
+		{
+			return 0;
+		}
+		*value = (uint8_t)Serial.read();
+		return 1;
+	}
+
+	static uint8_t RxPending(void)
+	{
+		return Serial.available() > 0;
+	}
+
+	static uint8_t Send(const uint8_t *Buf, uint16_t Len, GizUart_TxDoneFunc Done, void *Arg)
+	{
+		GizUart_SegTypeDef seg;
+
+		if(Len > 255)
+		{
+			return 0;
+		}
+		seg.Buf = Buf;
+		seg.Len = Len;
+		seg.Type = GIZ_SEG_COPY;
+		return SendV(&seg, 1, Done, Arg);
+	}
+
+	static uint8_t SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg);
+
+	static void Poll(void)
+	{
+		GizStream_DoneTypeDef *done;
+
+		while(Done_Head != Done_Tail)
+		{
+			done = &Done_Queue[Done_Head & (GIZ_TX_QUEUE_LEN - 1)];
+			Done_Head++;
+			done->Done(done->Arg);
+		}
+	}
+
+	static uint8_t TxIdle(void)
+	{
+		return 1;
+	}
+
+	static uint16_t RxOverflow(void)
+	{
+		return 0;
+	}
+};
+
+template<typename Port, Port &Serial>
+GizStream_DoneTypeDef GizStream_Transport<Port, Serial>::Done_Queue[GIZ_TX_QUEUE_LEN];
+template<typename Port, Port &Serial>
+uint8_t GizStream_Transport<Port, Serial>::Done_Tail = 0;
+template<typename Port, Port &Serial>
+uint8_t GizStream_Transport<Port, Serial>::Done_Head = 0;
+
+/*******************************************************************************
+* Function Name  : SendV
+* Description    : 按分段写出一帧，帧头之后出现的0xFF紧跟着补发0x55
+* Input          : Seg:分段，按顺序组成一帧(未转义)，Seg[0] 可带 GIZ_SEG_CONT； SegNum:分段数，最多 GIZ_TX_MAX_SEG；
+*                  Done:发送完成回调，可为NULL； Arg:回调参数
+* Output         : None
+* Return         : 1:已写出； 0:分段非法
+* Attention		   : SoftwareSerial 的 write 在发送期间关中断，整帧写完才返回
+*******************************************************************************/
+template<typename Port, Port &Serial>
+uint8_t GizStream_Transport<Port, Serial>::SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg)
+{
+	const uint8_t *p;
+	uint16_t pos;
+	uint16_t len = 0;
+	uint8_t value;
+	uint8_t i, k;
+
+	if(SegNum == 0 || SegNum > GIZ_TX_MAX_SEG)
+	{
+		return 0;
+	}
+	pos = (Seg[0].Type & GIZ_SEG_CONT) ? 2 : 0;
+	for(k = 0; k < SegNum; k++)
+	{
+		p = Seg[k].Buf;
+		for(i = 0; i < Seg[k].Len; i++, pos++, len++)
+		{
+			value = (GIZ_SEG_TYPE(Seg[k].Type) == GIZ_SEG_PGM) ? pgm_read_byte(p + i) : p[i];
+			Serial.write(value);
+			if(pos >= 2 && value == 0xFF)
+			{
+				Serial.write((uint8_t)0x55);
+			}
+		}
+	}
+	if(len == 0)
+	{
+		return 0;
+	}
+
+	if(Done != NULL)
+	{
+		if((uint8_t)(Done_Tail - Done_Head) >= GIZ_TX_QUEUE_LEN)
+		{
+			Poll();
+		}
+		Done_Queue[Done_Tail & (GIZ_TX_QUEUE_LEN - 1)].Done = Done;
+		Done_Queue[Done_Tail & (GIZ_TX_QUEUE_LEN - 1)].Arg = Arg;
+		Done_Tail++;
+	}
+	return 1;
+}
+
+#endif
@@ -0,0 +1,247 @@
+/********************************************************
+*
+* @file      [GizTrace.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#include "GizTrace.h"
+
+#if (GIZ_TRACE == 1)
+
+#define TRACE_MASK			(GIZ_TRACE_SIZE - 1)
+#define TRACE_MAX_DATA		0x7F
+
+/*记录缓冲区
+* 只在串口中断里写入(收发两个中断不会互相打断)，导出时先置 trace_pause，
+* 之后中断不再修改缓冲区，主循环可以安全读取。*/
+static uint8_t trace_buf[GIZ_TRACE_SIZE];
+static uint16_t trace_head = 0;		//最旧记录的起点
+static uint16_t trace_tail = 0;		//写入位置
+static uint16_t trace_rec = 0;		//当前记录头的位置
+static uint8_t trace_open = 0;		//当前记录还可以继续追加字节
+static uint32_t trace_base = 0;		//最旧记录的时间差相对的时间
+static uint32_t trace_last = 0;		//最新记录的开始时间
+static uint32_t trace_byte_time = 0;	//最后一个字节的时间
+static volatile uint8_t trace_pause = 0;
+
+//分段导出的进度，trace_dump_put 为 NULL 表示没有进行中的导出
+static GizTrace_PutFunc trace_dump_put = NULL;
+static uint8_t trace_dump_head[10];		//导出头
+static uint8_t trace_dump_hpos = 0;		//导出头已输出的字节数
+static uint16_t trace_dump_pos = 0;		//下一个要输出的记录字节
+
+/*******************************************************************************
+* Function Name  : Trace_Evict
+* Description    : 丢弃最旧的一条记录，并把它的时间累加到基准时间
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : 被丢弃的是当前记录时，之后的字节另起一条记录
+*******************************************************************************/
+static void Trace_Evict(void)
+{
+	uint16_t pos = trace_head;
+	uint8_t count = trace_buf[pos++ & TRACE_MASK] & TRACE_MAX_DATA;
+	uint32_t delta = 0;
+	uint8_t shift = 0;
+	uint8_t value;
+
+	do
+	{
+		value = trace_buf[pos++ & TRACE_MASK];
+		delta |= (uint32_t)(value & 0x7F) << shift;
+		shift += 7;
+	}while(value & 0x80);
+
+	if(trace_head == trace_rec)
+	{
+		trace_open = 0;
+	}
+	trace_base += delta;
+	trace_head = pos + count;
+}
+
+static void Trace_Reserve(uint8_t Len)
+{
+	while((uint16_t)(GIZ_TRACE_SIZE - (uint16_t)(trace_tail - trace_head)) < Len)
+	{
+		Trace_Evict();
+	}
+}
+
+/*******************************************************************************
+* Function Name  : GizTrace_Byte
+* Description    : 记录线上收到或发出的一个字节
+* Input          : Dir:GIZ_TRACE_RX 或 GIZ_TRACE_TX； Value:线上字节
+* Output         : None
+* Return         : None
+* Attention		   : 在串口中断里调用，时间取 SystemTimeCount
+*******************************************************************************/
+void GizTrace_Byte(uint8_t Dir, uint8_t Value)
+{
+	uint32_t now = SystemTimeCount;
+	uint32_t delta;
+	uint8_t head;
+	uint8_t len = 1;
+
+	if(trace_pause)
+	{
+		return;
+	}
+
+	head = trace_buf[trace_rec & TRACE_MASK];
+	if(trace_open && (head & GIZ_TRACE_TX) == Dir && (head & TRACE_MAX_DATA) < TRACE_MAX_DATA &&
+		(now - trace_byte_time) <= GIZ_TRACE_GAP)
+	{
+		Trace_Reserve(1);
+		if(trace_open)
+		{
+			trace_buf[trace_tail++ & TRACE_MASK] = Value;
+			trace_buf[trace_rec & TRACE_MASK] = head + 1;
+			trace_byte_time = now;
+			return;
+		}
+	}
+
+	//新记录：记录头 + 时间差 + 第一个字节
+	for(delta = now - trace_last; delta >= 0x80; delta >>= 7)
+	{
+		len++;
+	}
+	Trace_Reserve(len + 2);
+
+	trace_rec = trace_tail;
+	trace_buf[trace_tail++ & TRACE_MASK] = Dir | 1;
+	for(delta = now - trace_last; delta >= 0x80; delta >>= 7)
+	{
+		trace_buf[trace_tail++ & TRACE_MASK] = (uint8_t)delta | 0x80;
+	}
+	trace_buf[trace_tail++ & TRACE_MASK] = (uint8_t)delta;
+	trace_buf[trace_tail++ & TRACE_MASK] = Value;
+	trace_open = 1;
+	trace_last = now;
+	trace_byte_time = now;
+}
+
+/*******************************************************************************
+* Function Name  : GizTrace_Clear
+* Description    : 清空记录
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+void GizTrace_Clear(void)
+{
+	trace_pause = 1;
+	trace_head = trace_tail = trace_rec = 0;
+	trace_open = 0;
+	trace_base = trace_last = SystemTimeCount;
+	trace_pause = 0;
+}
+
+/*******************************************************************************
+* Function Name  : GizTrace_DumpStart
+* Description    : 开始导出全部记录，之后由 GizTrace_DumpPoll 每次输出几个字节，记录本身保留
+* Input          : Put:逐字节输出函数
+* Output         : None
+* Return         : 要输出的记录字节数(不含导出头)
+* Attention		   : 导出期间暂停记录，这段时间的收发不会出现在记录里；
+*                  上一次导出未完成时重新开始
+*******************************************************************************/
+uint16_t GizTrace_DumpStart(GizTrace_PutFunc Put)
+{
+	uint16_t len;
+	uint8_t i;
+
+	//AVR上中断不会被主循环打断，置位之后中断里不会再有写到一半的记录
+	trace_pause = 1;
+
+	len = trace_tail - trace_head;
+	trace_dump_head[0] = 'G';
+	trace_dump_head[1] = 'Z';
+	trace_dump_head[2] = 'T';
+	trace_dump_head[3] = '1';
+	for(i = 0; i < 4; i++)
+	{
+		trace_dump_head[4 + i] = (uint8_t)(trace_base >> (8 * i));
+	}
+	trace_dump_head[8] = (uint8_t)len;
+	trace_dump_head[9] = (uint8_t)(len >> 8);
+	trace_dump_hpos = 0;
+	trace_dump_pos = trace_head;
+	trace_dump_put = Put;
+	return len;
+}
+
+/*******************************************************************************
+* Function Name  : GizTrace_DumpPoll
+* Description    : 空闲时输出导出内容的下一段，最多 GIZ_TRACE_CHUNK 字节
+* Input          : Idle:1 协议栈的接收缓冲区已取空且发送队列已发完
+* Output         : None
+* Return         : 1:导出尚未完成，本次不应再输出其他调试信息； 0:没有进行中的导出
+* Attention		   : 由协议栈的 MessageHandle 每次调用，与 GizLog_Drain 一样
+*                  只在空闲时输出，经 SoftwareSerial 输出时每次只关中断几个字节的时间
+*******************************************************************************/
+uint8_t GizTrace_DumpPoll(uint8_t Idle)
+{
+	uint8_t i;
+
+	if(trace_dump_put == NULL)
+	{
+		return 0;
+	}
+	if(Idle == 0)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < GIZ_TRACE_CHUNK; i++)
+	{
+		if(trace_dump_hpos < sizeof(trace_dump_head))
+		{
+			trace_dump_put(trace_dump_head[trace_dump_hpos++]);
+		}
+		else if(trace_dump_pos != trace_tail)
+		{
+			trace_dump_put(trace_buf[trace_dump_pos++ & TRACE_MASK]);
+		}
+		else
+		{
+			//导出占用的时间不算进下一条记录的字节间隔
+			trace_dump_put = NULL;
+			trace_open = 0;
+			trace_pause = 0;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : GizTrace_Dump
+* Description    : 一次输出全部记录，记录本身保留
+* Input          : Put:逐字节输出函数
+* Output         : None
+* Return         : 输出的记录字节数(不含导出头)
+* Attention		   : 不等待空闲，直到输出完才返回；
+*                  设备上应改用 GizTrace_DumpStart，由 MessageHandle 分段输出
+*******************************************************************************/
+uint16_t GizTrace_Dump(GizTrace_PutFunc Put)
+{
+	uint16_t len = GizTrace_DumpStart(Put);
+
+	while(GizTrace_DumpPoll(1))
+	{
+	}
+	return len;
+}
+
+#endif
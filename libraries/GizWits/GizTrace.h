@@ -0,0 +1,70 @@
+/********************************************************
+*
+* @file      [GizTrace.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZTRACE_H
+#define _GIZTRACE_H
+
+#include "GizWits.h"
+
+/******************************************************
+* 与WiFi模组之间的串口收发记录(trace)
+* 串口收发中断把线上的每个字节(含0x55转义)记入RAM环形缓冲区，
+* 缓冲区满时丢弃最旧的记录，因此总是保留最近一段通信，
+* 出现问题后调用 GizTrace_DumpStart 导出，由 MessageHandle 在空闲时分段输出，
+* 用 tools/trace_replay 回放。
+*
+* 记录格式：
+*   记录头  1字节   bit7:方向(0:模组->MCU，1:MCU->模组)，bit0-6:数据字节数(1-127)
+*   时间差  1-5字节 与上一条记录开始时间之差(ms)，每字节7位，低位在前，bit7为1表示后面还有
+*   数据    n字节   线上原始字节
+* 同一方向、相邻字节间隔不超过 GIZ_TRACE_GAP ms 的字节合并为一条记录。
+*
+* 导出格式：'G' 'Z' 'T' '1'，基准时间(4字节，低位在前)，记录总长(2字节，低位在前)，记录。
+* 第一条记录的时间 = 基准时间 + 它的时间差。
+*
+* 默认关闭，需要抓取现场设备的通信时用编译选项 -DGIZ_TRACE=1 打开
+* (如 platform.local.txt 中的 compiler.cpp.extra_flags)，库和草图必须一致，
+* 只在 .ino 中 #define 不会作用到库里的 GizUart.cpp/GizTrace.cpp。
+********************************************************/
+#ifndef GIZ_TRACE
+#define GIZ_TRACE			0		//1:记录串口收发，占用 GIZ_TRACE_SIZE 字节RAM； 0:不占用RAM，也不增加中断开销
+#endif
+#ifndef GIZ_TRACE_SIZE
+#define GIZ_TRACE_SIZE		512		//记录缓冲区大小，必须是2的幂，最大32768
+#endif
+#define GIZ_TRACE_GAP		2		//同一记录内相邻字节的最大间隔(ms)
+#define GIZ_TRACE_CHUNK		8		//分段导出时每次最多输出的字节数
+
+#define GIZ_TRACE_RX		0x00
+#define GIZ_TRACE_TX		0x80
+
+#if (GIZ_TRACE_SIZE & (GIZ_TRACE_SIZE - 1)) != 0 || GIZ_TRACE_SIZE > 32768
+#error "GIZ_TRACE_SIZE must be a power of two no larger than 32768"
+#endif
+
+//导出时逐字节输出，如 mySerial.write
+typedef void (*GizTrace_PutFunc)(uint8_t value);
+
+#if (GIZ_TRACE == 1)
+#define GIZ_TRACE_BYTE(dir, value)	GizTrace_Byte(dir, value)
+void GizTrace_Byte(uint8_t Dir, uint8_t Value);
+void GizTrace_Clear(void);
+uint16_t GizTrace_DumpStart(GizTrace_PutFunc Put);
+uint8_t GizTrace_DumpPoll(uint8_t Idle);
+uint16_t GizTrace_Dump(GizTrace_PutFunc Put);
+#else
+#define GIZ_TRACE_BYTE(dir, value)
+#define GizTrace_DumpPoll(Idle)		0
+#endif
+
+#endif
@@ -0,0 +1,339 @@
+/********************************************************
+*
+* @file      [GizUart.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#include "GizUart.h"
+#include "GizTrace.h"
+
+#if defined(__AVR__) && (GIZ_UART == 1)
+#include <avr/interrupt.h>
+
+#ifdef M5_VERSION
+#define GIZ_UBRR			UBRR1
+#define GIZ_UCSRA			UCSR1A
+#define GIZ_UCSRB			UCSR1B
+#define GIZ_UCSRC			UCSR1C
+#define GIZ_UDR				UDR1
+#define GIZ_U2X				U2X1
+#define GIZ_UDRE			UDRE1
+#define GIZ_RXEN			RXEN1
+#define GIZ_TXEN			TXEN1
+#define GIZ_RXCIE			RXCIE1
+#define GIZ_UDRIE			UDRIE1
+#define GIZ_UCSZ0			UCSZ10
+#define GIZ_UCSZ1			UCSZ11
+#define GIZ_RX_vect			USART1_RX_vect
+#define GIZ_UDRE_vect		USART1_UDRE_vect
+#else
+#define GIZ_UBRR			UBRR0
+#define GIZ_UCSRA			UCSR0A
+#define GIZ_UCSRB			UCSR0B
+#define GIZ_UCSRC			UCSR0C
+#define GIZ_UDR				UDR0
+#define GIZ_U2X				U2X0
+#define GIZ_UDRE			UDRE0
+#define GIZ_RXEN			RXEN0
+#define GIZ_TXEN			TXEN0
+#define GIZ_RXCIE			RXCIE0
+#define GIZ_UDRIE			UDRIE0
+#define GIZ_UCSZ0			UCSZ00
+#define GIZ_UCSZ1			UCSZ01
+#if defined(USART0_RX_vect)
+#define GIZ_RX_vect			USART0_RX_vect
+#define GIZ_UDRE_vect		USART0_UDRE_vect
+#else
+#define GIZ_RX_vect			USART_RX_vect
+#define GIZ_UDRE_vect		USART_UDRE_vect
+#endif
+#endif
+
+RingBuffer<GIZ_RX_RING_SIZE> u_ring_buff; //环形buff
+static volatile uint16_t rx_overflow = 0; //环形buff满时丢弃的字节数
+
+/*发送队列
+* 需拷贝的分段按原样存放在 tx_ring，帧描述(含分段地址)存放在 tx_frame。
+* tx_frame_tail 由主循环写入新帧时递增，tx_frame_sent 由中断发完一帧时递增，
+* tx_frame_free 由 GizUart_Poll 通知完回调后递增。*/
+static RingBuffer<GIZ_TX_RING_SIZE> tx_ring;
+static GizUart_TxFrameTypeDef tx_frame[GIZ_TX_QUEUE_LEN];
+static volatile uint8_t tx_frame_tail = 0;
+static volatile uint8_t tx_frame_sent = 0;
+static uint8_t tx_frame_free = 0;
+
+//中断内当前帧的发送进度
+static uint16_t tx_remain = 0;
+static uint16_t tx_pos = 0;
+static uint8_t tx_escape = 0;
+static uint8_t tx_seg = 0;				//下一个分段
+static uint8_t tx_seg_remain = 0;		//当前分段剩余字节
+static uint8_t tx_seg_type = GIZ_SEG_COPY;	//当前分段的类型
+static const uint8_t *tx_seg_ptr = NULL;	//当前分段的地址，GIZ_SEG_COPY 时不用
+
+/******************************************************
+ *    function    : GIZ_RX_vect
+ *    Description : 串口接收中断，收到的字节直接写入环形缓冲区；
+ *                  缓冲区满时丢弃该字节并计数。
+ *                  中断里不做任何打印，调试输出在协议栈的 Pro_GetFrame 中按帧进行；
+ *                  打开 GIZ_TRACE 时同时记入收发记录。
+******************************************************/
+ISR(GIZ_RX_vect)
+{
+	uint8_t value = GIZ_UDR;
+
+	GIZ_TRACE_BYTE(GIZ_TRACE_RX, value);
+	if(rb_put(&u_ring_buff, value) == 0)
+	{
+		rx_overflow++;
+	}
+}
+
+/******************************************************
+ *    function    : GIZ_UDRE_vect
+ *    Description : 发送数据寄存器空中断，依次发出队列中各帧的各分段；
+ *                  帧头之后出现的0xFF，紧跟着补发0x55。
+ *                  队列发空后关闭本中断。
+******************************************************/
+ISR(GIZ_UDRE_vect)
+{
+	GizUart_TxFrameTypeDef *frame = &tx_frame[tx_frame_sent & (GIZ_TX_QUEUE_LEN - 1)];
+	uint8_t value = 0;
+
+	if(tx_escape)
+	{
+		GIZ_UDR = 0x55;
+		GIZ_TRACE_BYTE(GIZ_TRACE_TX, 0x55);
+		tx_escape = 0;
+		if(tx_remain == 0)
+		{
+			tx_frame_sent++;
+		}
+		return;
+	}
+
+	if(tx_remain == 0)
+	{
+		if(tx_frame_sent == tx_frame_tail)
+		{
+			GIZ_UCSRB &= ~(1 << GIZ_UDRIE);
+			return;
+		}
+		tx_remain = frame->Len;
+		tx_pos = (frame->Seg[0].Type & GIZ_SEG_CONT) ? 2 : 0;
+		tx_seg = 0;
+		tx_seg_remain = 0;
+	}
+
+	while(tx_seg_remain == 0)
+	{
+		tx_seg_remain = frame->Seg[tx_seg].Len;
+		tx_seg_type = GIZ_SEG_TYPE(frame->Seg[tx_seg].Type);
+		tx_seg_ptr = frame->Seg[tx_seg].Buf;
+		tx_seg++;
+	}
+	if(tx_seg_type == GIZ_SEG_COPY)
+	{
+		rb_get(&tx_ring, &value);
+	}
+	else if(tx_seg_type == GIZ_SEG_PGM)
+	{
+		value = pgm_read_byte(tx_seg_ptr++);
+	}
+	else
+	{
+		value = *tx_seg_ptr++;
+	}
+	tx_seg_remain--;
+	GIZ_UDR = value;
+	GIZ_TRACE_BYTE(GIZ_TRACE_TX, value);
+	if(tx_pos >= 2 && value == 0xFF)
+	{
+		tx_escape = 1;
+	}
+	tx_pos++;
+	tx_remain--;
+	if(tx_remain == 0 && tx_escape == 0)
+	{
+		tx_frame_sent++;
+	}
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_Init
+* Description    : 初始化串口 8N1，打开接收中断
+* Input          : baud:波特率
+* Output         : None
+* Return         : None
+* Attention		   : 使用倍速模式，与 HardwareSerial 的分频计算一致
+*******************************************************************************/
+void GizUart_Init(uint32_t baud)
+{
+	uint16_t baud_setting = (F_CPU / 4 / baud - 1) / 2;
+
+	rb_new(&u_ring_buff);
+	rb_new(&tx_ring);
+	tx_frame_tail = tx_frame_sent = tx_frame_free = 0;
+	tx_remain = tx_pos = 0;
+	tx_escape = 0;
+	tx_seg = tx_seg_remain = 0;
+
+	GIZ_UCSRB = 0;
+	GIZ_UCSRA = (1 << GIZ_U2X);
+	GIZ_UBRR = baud_setting;
+	GIZ_UCSRC = (1 << GIZ_UCSZ1) | (1 << GIZ_UCSZ0);
+	GIZ_UCSRB = (1 << GIZ_RXEN) | (1 << GIZ_TXEN) | (1 << GIZ_RXCIE);
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_Send
+* Description    : 把一帧加入发送队列，立即返回，由中断完成发送及0xFF转义
+* Input          : Buf:未转义的帧； Len:帧长度； Done:发送完成回调，可为NULL； Arg:回调参数
+* Output         : None
+* Return         : 1:已入队； 0:帧长超过发送缓冲区
+* Attention		   : 整帧拷入发送缓冲区，调用返回后 Buf 即可重用
+*******************************************************************************/
+uint8_t GizUart_Send(const uint8_t *Buf, uint16_t Len, GizUart_TxDoneFunc Done, void *Arg)
+{
+	GizUart_SegTypeDef seg;
+
+	if(Len > GIZ_TX_RING_SIZE)
+	{
+		return 0;
+	}
+	seg.Buf = Buf;
+	seg.Len = Len;
+	seg.Type = GIZ_SEG_COPY;
+	return GizUart_SendV(&seg, 1, Done, Arg);
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_SendV
+* Description    : 按分段把一帧加入发送队列，立即返回
+* Input          : Seg:分段，按顺序组成一帧(未转义)； SegNum:分段数，最多 GIZ_TX_MAX_SEG；
+*                  Done:发送完成回调，可为NULL； Arg:回调参数
+* Output         : None
+* Return         : 1:已入队； 0:分段非法或需拷贝的字节超过发送缓冲区
+* Attention		   : GIZ_SEG_REF 分段由中断直接读取，在 Done 回调之前不能修改；
+*                  Seg[0] 带 GIZ_SEG_CONT 时本帧是上一帧的后续部分，不再把前两个字节当作帧头；
+*                  仅当队列或发送缓冲区已满时才等待中断腾出空间
+*******************************************************************************/
+uint8_t GizUart_SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg)
+{
+	GizUart_TxFrameTypeDef *frame;
+	uint16_t len = 0;
+	uint16_t copy = 0;
+	uint8_t i;
+
+	if(SegNum == 0 || SegNum > GIZ_TX_MAX_SEG)
+	{
+		return 0;
+	}
+	for(i = 0; i < SegNum; i++)
+	{
+		len += Seg[i].Len;
+		if(GIZ_SEG_TYPE(Seg[i].Type) == GIZ_SEG_COPY)
+		{
+			copy += Seg[i].Len;
+		}
+	}
+	if(len == 0 || copy > GIZ_TX_RING_SIZE)
+	{
+		return 0;
+	}
+
+	//队列满时先把已发完帧的回调通知掉，释放描述符
+	while((uint8_t)(tx_frame_tail - tx_frame_free) >= GIZ_TX_QUEUE_LEN || rb_can_write(&tx_ring) < copy)
+	{
+		GizUart_Poll();
+	}
+
+	frame = &tx_frame[tx_frame_tail & (GIZ_TX_QUEUE_LEN - 1)];
+	for(i = 0; i < GIZ_TX_MAX_SEG; i++)
+	{
+		if(i < SegNum)
+		{
+			frame->Seg[i] = Seg[i];
+			if(GIZ_SEG_TYPE(Seg[i].Type) == GIZ_SEG_COPY)
+			{
+				rb_write(&tx_ring, Seg[i].Buf, Seg[i].Len);
+			}
+		}
+		else
+		{
+			frame->Seg[i].Len = 0;
+		}
+	}
+	frame->Len = len;
+	frame->Done = Done;
+	frame->Arg = Arg;
+	RB_BARRIER();
+	tx_frame_tail++;
+
+	GIZ_UCSRB |= (1 << GIZ_UDRIE);
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_Poll
+* Description    : 在主循环中调用已发送完成帧的回调，并释放其队列位置
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+void GizUart_Poll(void)
+{
+	GizUart_TxFrameTypeDef *frame;
+
+	while(tx_frame_free != tx_frame_sent)
+	{
+		frame = &tx_frame[tx_frame_free & (GIZ_TX_QUEUE_LEN - 1)];
+		if(frame->Done != NULL)
+		{
+			frame->Done(frame->Arg);
+		}
+		tx_frame_free++;
+	}
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_TxIdle
+* Description    : 发送队列是否已全部发出
+* Input          : None
+* Output         : None
+* Return         : 1:空闲； 0:仍有帧在发送
+* Attention		   : None
+*******************************************************************************/
+uint8_t GizUart_TxIdle(void)
+{
+	return (tx_frame_sent == tx_frame_tail);
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_RxOverflow
+* Description    : 接收环形缓冲区满时丢失的字节数
+* Input          : None
+* Output         : None
+* Return         : 字节数
+* Attention		   : 计数由中断修改，读取时关中断保证16位读取完整
+*******************************************************************************/
+uint16_t GizUart_RxOverflow(void)
+{
+	uint16_t value;
+	uint8_t sreg = SREG;
+
+	cli();
+	value = rx_overflow;
+	SREG = sreg;
+	return value;
+}
+
+#endif
@@ -0,0 +1,100 @@
+/********************************************************
+*
+* @file      [GizUart.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZUART_H
+#define _GIZUART_H
+
+#include "GizWits.h"
+
+/******************************************************
+* 与WiFi模组通信的串口驱动
+* 直接操作USART寄存器：M5_VERSION 使用USART1，否则使用USART0。
+* 接收中断把字节直接写入 u_ring_buff，不再依赖 loop() 之后的 serialEvent。
+* 发送为帧队列：GizUart_Send 把整帧拷入发送环形缓冲区后立即返回，
+* 由数据寄存器空中断逐字节发出，并在中断里完成 0xFF 后补 0x55 的转义。
+* GizUart_SendV 按分段发送一帧，不拷贝的分段由中断直接从调用者的缓冲区读取，
+* 例如状态上报只拷贝帧头和校验和，P0数据直接从协议栈的 DevStatus 发出；
+* 不变的数据(如设备信息)可以直接从 PROGMEM 发出。
+* 一帧也可以分几次入队：后续部分的第一个分段带 GIZ_SEG_CONT，其中的0xFF全部转义。
+* 注意：本驱动占用对应USART的中断向量，sketch 中不能再使用 Serial1/Serial。
+* GIZ_UART 为0时不编译本驱动，协议栈可改用 GizStream_Transport 经 HardwareSerial 通信。
+********************************************************/
+#ifndef GIZ_UART
+#define GIZ_UART			1
+#endif
+#define GIZ_TX_QUEUE_LEN	4		//最多排队的帧数，必须是2的幂
+#ifndef GIZ_RX_RING_SIZE
+#define GIZ_RX_RING_SIZE	128		//接收环形缓冲区，必须是2的幂，最大128
+#endif
+#ifndef GIZ_TX_RING_SIZE
+#define GIZ_TX_RING_SIZE	128		//发送环形缓冲区(存放需拷贝的分段)，同上；一帧的拷贝分段之和不能超过它
+#endif
+#define GIZ_TX_MAX_SEG		3		//每帧最多的分段数
+
+#if (GIZ_TX_QUEUE_LEN & (GIZ_TX_QUEUE_LEN - 1)) != 0
+#error "GIZ_TX_QUEUE_LEN must be a power of two"
+#endif
+
+//发送完成回调，在 GizUart_Poll 中(主循环上下文)调用
+typedef void (*GizUart_TxDoneFunc)(void *arg);
+
+//发送分段的类型
+#define GIZ_SEG_REF			0		//只记录RAM地址，数据须保持不变直到该帧的发送完成回调
+#define GIZ_SEG_COPY		1		//入队时拷入发送缓冲区
+#define GIZ_SEG_PGM			2		//只记录 PROGMEM 地址，中断用 pgm_read_byte 读取
+#define GIZ_SEG_CONT		0x80	//与第一个分段的类型组合：本帧接续上一帧(分块发送的后续部分)，从第一个字节起转义
+#define GIZ_SEG_TYPE(t)		((t) & 0x7F)
+
+typedef struct
+{
+	const uint8_t			*Buf;
+	uint8_t					Len;
+	uint8_t					Type;		//GIZ_SEG_REF / GIZ_SEG_COPY / GIZ_SEG_PGM，可加 GIZ_SEG_CONT
+}GizUart_SegTypeDef;
+
+typedef struct
+{
+	uint16_t				Len;		//未转义的帧长度，各分段之和
+	GizUart_SegTypeDef		Seg[GIZ_TX_MAX_SEG];
+	GizUart_TxDoneFunc		Done;
+	void					*Arg;
+}GizUart_TxFrameTypeDef;
+
+extern RingBuffer<GIZ_RX_RING_SIZE> u_ring_buff; //接收环形buff，中断写，Pro_GetFrame读
+
+void GizUart_Init(uint32_t baud);
+uint8_t GizUart_Send(const uint8_t *Buf, uint16_t Len, GizUart_TxDoneFunc Done, void *Arg);
+uint8_t GizUart_SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg);
+void GizUart_Poll(void);
+uint8_t GizUart_TxIdle(void);
+uint16_t GizUart_RxOverflow(void);
+
+/******************************************************
+* 协议栈 GizWits<> 的传输策略：本驱动
+* 全部为静态内联函数，编译时绑定，调用直接展开为上面的 GizUart_ 函数
+********************************************************/
+struct GizUart_Transport
+{
+	static constexpr uint16_t RamSize = sizeof(RingBuffer<GIZ_RX_RING_SIZE>) + sizeof(RingBuffer<GIZ_TX_RING_SIZE>) + GIZ_TX_QUEUE_LEN * sizeof(GizUart_TxFrameTypeDef);
+
+	static void Init(uint32_t baud) { GizUart_Init(baud); }
+	static uint8_t Read(uint8_t *value) { return rb_get(&u_ring_buff, value); }
+	static uint8_t RxPending(void) { return rb_can_read(&u_ring_buff) != 0; }
+	static uint8_t Send(const uint8_t *Buf, uint16_t Len, GizUart_TxDoneFunc Done, void *Arg) { return GizUart_Send(Buf, Len, Done, Arg); }
+	static uint8_t SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg) { return GizUart_SendV(Seg, SegNum, Done, Arg); }
+	static void Poll(void) { GizUart_Poll(); }
+	static uint8_t TxIdle(void) { return GizUart_TxIdle(); }
+	static uint16_t RxOverflow(void) { return GizUart_RxOverflow(); }
+};
+
+#endif
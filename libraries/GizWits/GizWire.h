@@ -0,0 +1,176 @@
+/********************************************************
+*
+* @file      [GizWire.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZWIRE_H
+#define _GIZWIRE_H
+
+#include <stdint.h>
+
+/******************************************************
+* 协议中的16位字段
+* 线上一律高字节在前。be16<T> 按字节存放，赋值时拆成两个字节，读取时合成 T，
+* 放在按字节排列的帧结构中不引入对齐，也不需要再调用 exchangeBytes 转换。
+* T 为该字段的数值类型，如 uint16_t、int16_t。
+********************************************************/
+template<typename T>
+struct be16
+{
+	uint8_t			Byte[2];
+
+	be16 &operator=(T Value)
+	{
+		Byte[0] = (uint8_t)((uint16_t)Value >> 8);
+		Byte[1] = (uint8_t)Value;
+		return *this;
+	}
+	operator T() const
+	{
+		return (T)(((uint16_t)Byte[0] << 8) | Byte[1]);
+	}
+	//两个字节对校验和的贡献
+	uint8_t Sum() const
+	{
+		return (uint8_t)(Byte[0] + Byte[1]);
+	}
+};
+
+/******************************************************
+* 长度固定的发送帧
+* 命令字和整帧长度确定后，帧头中除SN以外的字节(FF FF、长度、命令字、Flags=0)
+* 以及它们对校验和的贡献都在编译时算出。运行时只需写入SN和数据：
+*   校验和 = HeadSum + SN + 数据各字节之和
+* 命令字由收到的帧决定时(如通用回复)，CmdValue 取0，运行时再写入并累加。
+********************************************************/
+template<uint8_t CmdValue, uint16_t FrameLen>
+struct Pro_FrameDesc
+{
+	static constexpr uint8_t	Cmd = CmdValue;
+	static constexpr uint16_t	Size = FrameLen;			//整帧长度，含帧头和校验和
+	static constexpr uint16_t	Len = FrameLen - 4;			//帧头中的长度字段
+	static constexpr uint8_t	HeadSum = (uint8_t)((Len >> 8) + (Len & 0xFF) + CmdValue);
+};
+
+//编译时求字符串前 Len 个字节之和，用于常量数据的校验和
+constexpr uint8_t Pro_ConstSum(const char *Str, uint16_t Len)
+{
+	return Len == 0 ? 0 : (uint8_t)((uint8_t)Str[0] + Pro_ConstSum(Str + 1, Len - 1));
+}
+
+/*******************************************************************************
+* Function Name  : Pro_FrameHead
+* Description    : 按帧描述填写8字节帧头
+* Input          : Head:帧起始地址； SN:序号
+* Output         : None
+* Return         : 帧头对校验和的贡献
+* Attention		   : 除SN外写入的都是编译时常量
+*******************************************************************************/
+template<typename Desc>
+inline uint8_t Pro_FrameHead(uint8_t *Head, uint8_t SN)
+{
+	Head[0] = 0xFF;
+	Head[1] = 0xFF;
+	Head[2] = (uint8_t)(Desc::Len >> 8);
+	Head[3] = (uint8_t)Desc::Len;
+	Head[4] = Desc::Cmd;
+	Head[5] = SN;
+	Head[6] = 0x00;
+	Head[7] = 0x00;
+	return (uint8_t)(Desc::HeadSum + SN);
+}
+
+/******************************************************
+* P0中的数据点
+* 由 tools/p0_gen 按数据点定义生成，每个数据点是一个只含编译时常量的类型。
+* Offset 为在所在区中的字节偏移：状态区从P0数据的第一个字节算起，
+* 控制区从 Attr_Flags 之后算起，两者的可写数据点位置相同。
+* 布尔和枚举用 Pro_P0Bits，占 Offset 字节中从 Shift 起(低位为0)的 Bits 位；
+* 数值用 Pro_P0Value，按大端占 sizeof(T) 个字节。
+* Set 写入前、Clamp 在交给 sketch 前把值限制在 [Min, Max]。
+* Offset/Size 为所在的整字节，可直接填入按属性上报的属性表。
+********************************************************/
+template<uint8_t OffsetValue, uint8_t Shift, uint8_t Bits, uint8_t MaxValue>
+struct Pro_P0Bits
+{
+	typedef uint8_t				Type;
+	static constexpr uint8_t	Offset = OffsetValue;
+	static constexpr uint8_t	Size = 1;
+	static constexpr uint8_t	Mask = (uint8_t)(((1u << Bits) - 1) << Shift);
+	static constexpr uint8_t	Min = 0;
+	static constexpr uint8_t	Max = MaxValue;
+
+	static_assert(Shift + Bits <= 8, "bit field crosses a byte boundary");
+	static_assert(MaxValue <= (Mask >> Shift), "bit field too narrow for its range");
+
+	static constexpr uint8_t Clamp(uint8_t Value)
+	{
+		return Value > Max ? Max : Value;
+	}
+	static constexpr uint8_t Get(const uint8_t *Section)
+	{
+		return (uint8_t)((Section[Offset] & Mask) >> Shift);
+	}
+	static void Set(uint8_t *Section, uint8_t Value)
+	{
+		Section[Offset] = (uint8_t)((Section[Offset] & ~Mask) | (Clamp(Value) << Shift));
+	}
+};
+
+template<uint8_t OffsetValue, typename T, uint32_t MinValue, uint32_t MaxValue>
+struct Pro_P0Value
+{
+	typedef T					Type;
+	static constexpr uint8_t	Offset = OffsetValue;
+	static constexpr uint8_t	Size = sizeof(T);
+	static constexpr T			Min = (T)MinValue;
+	static constexpr T			Max = (T)MaxValue;
+
+	static constexpr T Clamp(T Value)
+	{
+		return Value < Min ? Min : (Value > Max ? Max : Value);
+	}
+	//按大端合成，Len 为剩余字节数
+	static constexpr T Load(const uint8_t *p, uint8_t Len, T Value)
+	{
+		return Len == 0 ? Value : Load(p + 1, Len - 1, (T)(((uint32_t)Value << 8) | p[0]));
+	}
+	static constexpr T Get(const uint8_t *Section)
+	{
+		return Load(Section + Offset, sizeof(T), 0);
+	}
+	static void Set(uint8_t *Section, T Value)
+	{
+		uint32_t v = Clamp(Value);
+		uint8_t i;
+
+		for(i = sizeof(T); i > 0; i--)
+		{
+			Section[Offset + i - 1] = (uint8_t)v;
+			v >>= 8;
+		}
+	}
+};
+
+//按数据点读写状态区，P0 为 sketch 的状态结构
+template<typename Field, typename P0>
+inline typename Field::Type Pro_P0Get(const P0 &Status)
+{
+	return Field::Get((const uint8_t *)&Status);
+}
+
+template<typename Field, typename P0>
+inline void Pro_P0Set(P0 &Status, typename Field::Type Value)
+{
+	Field::Set((uint8_t *)&Status, Value);
+}
+
+#endif
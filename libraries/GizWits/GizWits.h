@@ -20,9 +20,11 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ringbuffer.h>
+#include <GizWire.h>
 
+#define M5_VERSION					//M5 使用USART1与WiFi模组通信，否则使用USART0
 #define PROTOCOL_DEBUG
-#define DEBUG				1	//arduino打印开关
+#define DEBUG				1	//调试日志开关，日志由 GizLog 在空闲时输出到 mySerial
 
 #define	PRO_VER				"00000004"
 #define	P0_VER				"00000004"
@@ -30,17 +32,30 @@
 #define	SOFT_VER			"02030001"
 #define	PRODUCT_KEY	"74e1cb642043430cb56d9137e658f1f9"  ///Curiousbox"ba9d369945ef4bb3bd4d3b449a2c1dc8"    ///默认"6f3074fe43894547a4f1314bd7e3ae0b"
 
-#define MAX_P0_LEN			128 	 		 //p0˽¾ޗ³¤¶ƍ
-#define MAX_PACKAGE_LEN		(MAX_P0_LEN*2) 	 //˽¾ݻº³戸خ´󳤶ƍ
-#define MAX_RINGBUFFER_LEN	MAX_PACKAGE_LEN  //»·ю»º³戸خ´󳤶ƍ
-#define Max_UartBuf			100
+//线上帧结构按字节排列；AVR本身没有对齐填充，此属性只影响主机编译
+#define GIZ_PACKED			__attribute__((packed))
+
+/******************************************************
+* 协议栈允许占用的静态RAM
+* 帧缓冲区由 GizWits<> 模板参数中P0结构的长度在编译时决定(见 GizWitsStack.h)，
+* 每个实例在 Init 中与串口缓冲区、调试缓冲区一起汇总，超过此值时编译失败。
+********************************************************/
+#ifndef GIZ_RAM_BUDGET
+#define GIZ_RAM_BUDGET		1280	//协议栈(含串口缓冲区及调试缓冲区)允许占用的静态RAM
+#endif
 
-#define USART2_RX_BUF_BOUND	Max_UartBuf-1
 #define RESTDEV_TIMER		600
+#define Frame_GapTime		50		//帧内字节间隔超过此时间(ms)放弃未完成的帧
 #define SoftAp_Mode			0x01
 #define AirLink_Mode		0x02
-#define Send_MaxTime   		200    
+#define Send_MaxTime   		200		//初始ACK超时时间，尚无RTT采样时使用
+#define Send_MinTime		50		//自适应超时下限
+#define Send_CapTime		3000	//自适应超时及退避上限
 #define Send_MaxNum    		2
+#ifndef Send_Window
+#define Send_Window			3		//同时等待ACK的最大帧数，可在编译时修改
+#endif
+#define Send_HeadMax		9		//等待ACK的帧保存的帧头长度：固定帧头及其后一个字节(Action/Config_Method)
 extern SoftwareSerial mySerial;
 extern uint32_t SystemTimeCount;
 
@@ -76,25 +91,86 @@ typedef enum
 	
 }Pro_CmdTypeDef;
 
+//串口接收帧解析状态
+typedef enum
+{
+	Pro_Parse_Head1						= 0x00,		//等待第一个0xFF
+	Pro_Parse_Head2						= 0x01,		//等待第二个0xFF
+	Pro_Parse_LenH						= 0x02,		//长度高字节
+	Pro_Parse_LenL						= 0x03,		//长度低字节
+	Pro_Parse_Body						= 0x04,		//命令字至校验和
+
+}Pro_ParseStateTypeDef;
+
 //设备串口通信
 typedef struct	
 {
-	uint8_t            				Message_Buf[Max_UartBuf]; //处理接收到指令的Buf
-	uint8_t             			Message_Len;	            //处理信息长度
+	uint8_t            				*Message_Buf;				//处理接收到指令的Buf(协议栈实例的 Rx_Buf)，解析器直接写入，处理函数直接引用
+	uint16_t             			Message_Len;	            //处理信息长度
+	uint8_t							Parse_State;				//Pro_ParseStateTypeDef
+	uint8_t							Parse_Escape;				//上一个数据字节为0xFF，下一个0x55需丢弃
+	uint8_t							Parse_Sum;					//边接收边累加的校验和
+	uint8_t							Parse_SumOk;				//整帧校验结果 1:正确 0:错误
+	uint16_t						Parse_Count;				//已写入Message_Buf的字节数
+	uint16_t						Parse_Len;					//帧总长度(Len + 4)
+	uint16_t						Parse_Time;					//最近一次取到字节的时间(ms)
+	uint8_t							Parse_Stream;				//Pro_StreamRxStateTypeDef
+	uint8_t							Stream_Fill;				//当前分块已收到的字节数
+	uint16_t						Stream_Offset;				//当前分块在数据中的偏移
 }UART_HandleTypeDef;
 
+//串口接收统计
+typedef struct	
+{
+	uint16_t						Frame_Num;					//收到的完整帧
+	uint16_t						SumErr_Num;					//其中校验和错误的帧
+	uint16_t						LenErr_Num;					//长度字段非法的帧
+	uint16_t						Resync_Num;					//放弃未完成的帧重新找帧头的次数
+	uint16_t						Timeout_Num;				//其中因字节间隔超时放弃的次数
+	uint16_t						Drop_Num;					//未能组成帧而丢弃的字节数
+	uint16_t						Overflow_Num;				//接收环形缓冲区满时丢失的字节数
+	uint16_t						Busy_Num;					//控制队列满、未回复ACK的控制帧
+	uint16_t						Dup_Num;					//重复的控制帧：只回复ACK，不再执行
+}Pro_RxStatTypeDef;
+
 /******************************************************
 * ACK 回复参数
-* SendTime 
+* 每个等待ACK的帧占用窗口中的一项，按 Cmd/SN 匹配，ACK 可乱序到达
+* SendTime 最近一次发送完成的时间
+* 只保存帧头和校验和，帧头之后的数据(如状态上报的P0数据)只记地址，
+* 重发时按分段直接从该地址发出，等待ACK期间该数据不能改变
 ********************************************************/
 typedef struct	
 {
     uint32_t        SendTime; 
 	uint8_t			SendNum;
 	uint8_t			Flag;
-	uint8_t			Cmd_Buff[Max_UartBuf];
+	uint16_t		Timeout;	//本帧当前超时时间，每次重发加倍
+	uint8_t			HeadLen;
+	uint8_t			Head[Send_HeadMax];
+	const uint8_t	*Body;
+	uint8_t			BodyLen;
+	uint8_t			Sum;
+	void			*Owner;		//所属的协议栈实例，发送完成回调由此找到实例
 }Pro_Wait_AckTypeDef;
 
+/******************************************************
+* ACK 重发统计
+* SRtt/RttVar 按 SRTT/RTTVAR 方法平滑，Rto = SRtt + 4 * RttVar
+* 重发过的帧不参与RTT采样
+********************************************************/
+typedef struct	
+{
+	uint16_t		Send_Num;		//需等待ACK的帧首次发送次数
+	uint16_t		Resend_Num;		//超时重发次数
+	uint16_t		Ack_Num;		//收到对应ACK的次数
+	uint16_t		AckLate_Num;	//收到ACK但已超时的次数
+	uint16_t		GiveUp_Num;		//超过重发次数放弃的帧数
+	uint16_t		SRtt;			//平滑后的ACK往返时间(ms)
+	uint16_t		RttVar;			//往返时间偏差(ms)
+	uint16_t		Rto;			//新帧使用的超时时间(ms)
+}Pro_AckStatTypeDef;
+
 
 /******************************************************
 * 协议的公用部分
@@ -102,12 +178,12 @@ typedef struct
 typedef struct	
 {
 	uint8_t							Head[2];
-	uint16_t						Len;
+	be16<uint16_t>					Len;
 	uint8_t							Cmd;
 	uint8_t							SN;
 	uint8_t							Flags[2];
 	
-}Pro_HeadPartTypeDef;
+}GIZ_PACKED Pro_HeadPartTypeDef;
 
 /******************************************************
 * 4.1  WiFi模组请求设备信息
@@ -120,10 +196,10 @@ typedef struct
 	uint8_t									Hard_ver[8];
 	uint8_t									Soft_ver[8];
 	uint8_t									Product_Key[32];
-	uint16_t								Binable_Time;
+	be16<uint16_t>							Binable_Time;
 	uint8_t									Sum;
 	
-}Pro_M2W_ReturnInfoTypeDef;
+}GIZ_PACKED Pro_M2W_ReturnInfoTypeDef;
 
 /*****************************************************
 *       通用命令，心跳、ack等可以复用此帧            *
@@ -138,7 +214,7 @@ typedef struct
 {
 	Pro_HeadPartTypeDef    				Pro_HeadPart;
 	uint8_t							  	Sum;
-}Pro_CommonCmdTypeDef;
+}GIZ_PACKED Pro_CommonCmdTypeDef;
 
 
 /******************************************************
@@ -149,7 +225,7 @@ typedef struct
 	Pro_HeadPartTypeDef  				Pro_HeadPart;
 	uint8_t                 			Config_Method;
 	uint8_t							  	Sum;
-}Pro_D2W_ConfigWifiTypeDef; 
+}GIZ_PACKED Pro_D2W_ConfigWifiTypeDef; 
 
 
 /*****************************************************
@@ -168,9 +244,9 @@ typedef struct
 typedef struct	
 {
 	Pro_HeadPartTypeDef    				Pro_HeadPart;
-	uint16_t                 			Wifi_Status;
+	be16<uint16_t>             			Wifi_Status;
 	uint8_t							  	Sum;
-}Pro_W2D_WifiStatusTypeDef;
+}GIZ_PACKED Pro_W2D_WifiStatusTypeDef;
 
 /*****************************************************
 * 非法信息通知枚举列表
@@ -193,7 +269,7 @@ typedef struct
 	uint8_t             					Error_Packets;
 	uint8_t									Sum;
 	
-}Pro_ErrorCmdTypeDef;
+}GIZ_PACKED Pro_ErrorCmdTypeDef;
 
 
 /*****************************************************
@@ -205,10 +281,76 @@ typedef enum
 	P0_W2D_ReadDevStatus_Action 		= 0x02,
 	P0_D2W_ReadDevStatus_Action_ACK 	= 0x03,
 	P0_D2W_ReportDevStatus_Action   	= 0X04,
+	P0_W2D_Transparent_Action			= 0x05,		//透传数据，长度不限于P0结构
+	P0_D2W_Transparent_Action			= 0x06,
 	
 }P0_ActionTypeDef;
 
 
+/******************************************************
+* 主动上报的属性描述
+* 上报帧仍为完整P0，属性表只决定何时上报以及哪些字段更新为当前值：
+* 变化量小于 Deadband 的字段视为未变化；普通属性两次上报间隔不小于 MinInterval；
+* Report_Urgent 类属性一旦变化立即上报，不受间隔限制，此时其他已变化的普通属性一并更新。
+* 多字节属性按大端(协议字节序)比较。属性表可放在 PROGMEM 中。
+********************************************************/
+#define Report_MaxAttr		16		//属性表最大项数
+#define Report_Normal		0x00
+#define Report_Urgent		0x01
+
+typedef struct	
+{
+	uint8_t				Offset;			//在P0中的偏移
+	uint8_t				Size;			//字节数
+	uint8_t				Class;			//Report_Normal / Report_Urgent
+	uint8_t				Deadband;		//小于此变化量不上报
+	uint16_t			MinInterval;	//两次上报的最小间隔(ms)
+}Pro_ReportAttrTypeDef;
+
+/******************************************************
+* 命令分发表
+* 收到的命令字直接作为下标查表，不再逐项比较。每项给出处理函数、标志和最短帧长：
+* Pro_Cmd_AutoAck 置位时协议栈先回复通用ACK(命令字+1)，再调用处理函数；
+* 帧长(含校验和)小于 MinLen 时回复非法消息通知(Error_Other)，不调用处理函数；
+* Pro_Cmd_P0Action 置位时帧头后第一个字节为P0 Action，还要满足该 Action 的最短帧长
+* (控制命令须带完整的控制P0结构，其余为帧头加Action)，分块接收的帧不再检查；
+* MinLen 为0的项表示命令不可识别，回复 Error_Cmd。
+* 标准命令(0x00~0x11)的表在编译时生成并放在 PROGMEM 中；
+* 厂商自定义命令由 RegisterCmd 登记，只有命令字超出标准表时才查找，最多 Pro_UserCmdMax 项。
+********************************************************/
+#define Pro_CmdStdNum		0x12	//标准命令表项数
+#ifndef Pro_UserCmdMax
+#define Pro_UserCmdMax		2		//可登记的厂商自定义命令数
+#endif
+#define Pro_Cmd_AutoAck		0x01
+#define Pro_Cmd_P0Action	0x02
+
+#ifndef Pro_CtrlQueueLen
+#define Pro_CtrlQueueLen	2		//已ACK、等待执行的控制命令数，必须是2的幂
+#endif
+#if (Pro_CtrlQueueLen & (Pro_CtrlQueueLen - 1)) != 0
+#error "Pro_CtrlQueueLen must be a power of two"
+#endif
+
+/******************************************************
+* 重复控制帧缓存
+* 模组没有及时收到ACK时会用相同的SN重发控制帧。最近接受的控制帧按
+* (命令字, SN, P0数据的校验值) 记录，Pro_DupTime 内再次收到相同的帧时只回复ACK，
+* 不再放入控制队列。SN 会回绕，超过 Pro_DupTime 的记录不再参与比较。
+********************************************************/
+#ifndef Pro_DupCacheLen
+#define Pro_DupCacheLen		4		//缓存的控制帧数
+#endif
+#define Pro_DupTime			5000	//判断重复的时间窗口(ms)，小于65536
+
+typedef struct
+{
+	uint8_t				Cmd;			//0:空
+	uint8_t				SN;
+	uint16_t			Hash;			//P0数据的 Fletcher-16 校验值
+	uint16_t			Time;			//接受时 SystemTimeCount 的低16位
+}Pro_DupTypeDef;
+
 /******************************************************
 * 带P0指令的公共部分
 ********************************************************/
@@ -216,27 +358,67 @@ typedef struct
 {
 	Pro_HeadPartTypeDef  		Pro_HeadPart;
     uint8_t                     Action; 
-}Pro_HeadPartP0CmdTypeDef;
-
-void Pro_W2D_GetMcuInfo(void);
-void Pro_W2D_CommonCmdHandle(void);
-void Pro_W2D_WifiStatusHandle(void);
-void Pr0_W2D_RequestResetDeviceHandle(void);
-void Pro_W2D_ErrorCmdHandle(Error_PacketsTypeDef Error_Type, uint8_t flag); 
-void Pro_W2D_ReadDevStatusHandle(void);
-void Pro_D2W_ReportDevStatusHandle(void);
-void Pro_UART_SendBuf(uint8_t *Buf, uint16_t PackLen, uint8_t Tag);
+}GIZ_PACKED Pro_HeadPartP0CmdTypeDef;
+
+/******************************************************
+* 大数据P0分块收发
+* 模组发来的P0帧长于接收缓冲区时不再按长度错误丢弃：Action 到达后由 Handler::StreamBegin
+* 决定是否接收，接收时数据每 Pro_StreamChunk 字节一块交给 Handler::StreamChunk。
+* 分块就放在接收缓冲区中帧头之后，不另占RAM；校验和在最后一个字节到达时核对，
+* 结果交给 Handler::StreamEnd，校验正确的帧由协议栈回复ACK。
+* 装得下接收缓冲区的非控制、非读取P0帧(如短的透传数据)收完后同样按 StreamBegin/StreamChunk/StreamEnd
+* 交给 Handler，Handler 是否收到数据与P0结构的大小无关；StreamBegin 拒绝时回复 Error_Other。
+* 发送时由生成函数按偏移逐块填写数据，协议栈边发边累加校验和，整帧不在RAM中；
+* 分块发送途中有其他帧要发时先把本帧发完。等待ACK及超时重发与状态上报相同。
+********************************************************/
+#ifndef Pro_StreamChunk
+#define Pro_StreamChunk		16		//每块最多的字节数，接收时不超过接收缓冲区帧头之后的长度
+#endif
+
+typedef enum
+{
+	Pro_Stream_None						= 0x00,		//普通帧
+	Pro_Stream_Wait						= 0x01,		//长帧，命令字及Action到达后决定是否接收
+	Pro_Stream_Recv						= 0x02,		//分块接收中
+	Pro_Stream_Done						= 0x03,		//已收完，等待分发
+
+}Pro_StreamRxStateTypeDef;
+
+typedef enum
+{
+	Pro_StreamTx_Idle					= 0x00,
+	Pro_StreamTx_Head					= 0x01,		//帧头尚未发出
+	Pro_StreamTx_Body					= 0x02,		//帧头已发出，数据发送中
+	Pro_StreamTx_Wait					= 0x03,		//已发完，等待ACK
+
+}Pro_StreamTxStateTypeDef;
+
+//分块发送的数据生成函数：把从 Offset 开始的 Len 字节写入 Buf，重发时从 Offset 0 重新调用
+typedef void (*Pro_StreamGenFunc)(void *Arg, uint16_t Offset, uint8_t *Buf, uint8_t Len);
+
+/******************************************************
+* 长度固定的发送帧，帧头常量及其校验和在编译时算出
+********************************************************/
+typedef Pro_FrameDesc<Pro_D2W__GetDeviceInfo_Ack_Cmd, sizeof(Pro_M2W_ReturnInfoTypeDef)>	Pro_D2W_DeviceInfoFrame;
+typedef Pro_FrameDesc<0, sizeof(Pro_CommonCmdTypeDef)>										Pro_D2W_CommonAckFrame;		//命令字为收到的命令字+1
+typedef Pro_FrameDesc<Pro_D2W_ErrorPackage_Ack_Cmd, sizeof(Pro_ErrorCmdTypeDef)>			Pro_D2W_ErrorAckFrame;
+typedef Pro_FrameDesc<Pro_D2W_ResetWifi_Cmd, sizeof(Pro_CommonCmdTypeDef)>					Pro_D2W_ResetWifiFrame;
+typedef Pro_FrameDesc<Pro_D2W_ControlWifi_Config_Cmd, sizeof(Pro_D2W_ConfigWifiTypeDef)>	Pro_D2W_ConfigWifiFrame;
+
+/******************************************************
+* 4.1 设备信息回复中帧头之后、校验和之前的部分
+* 全部为常量，放在 PROGMEM 中(GizWits.cpp)，校验和的常量部分在编译时算好
+********************************************************/
+#define Pro_InfoStr			PRO_VER P0_VER HARD_VER SOFT_VER PRODUCT_KEY
+#define Pro_InfoBodyLen		(Pro_D2W_DeviceInfoFrame::Size - sizeof(Pro_HeadPartTypeDef) - 1)
+
+extern const uint8_t Pro_InfoBody[] PROGMEM;
+constexpr uint8_t Pro_InfoBodySum = Pro_ConstSum(Pro_InfoStr, sizeof(Pro_InfoStr) - 1);
+
 void Log_UART_SendBuf(uint8_t *Buf, uint16_t PackLen);
-short exchangeBytes(short	value);
 uint8_t CheckSum( uint8_t *buf, int packLen );
-void GizWits_init(uint8_t P0_Len);
-uint8_t Pro_GetFrame(void); 
-void GizWits_D2WResetCmd(void);
-void GizWits_D2WConfigCmd(uint8_t WiFi_Mode);
-void GizWits_DevStatusUpgrade(uint8_t * P0_Buff, uint32_t Time, uint8_t flag, uint8_t ConfigFlag); 
-void GizWits_WiFiStatueHandle(uint16_t wifiStatue); 
-uint8_t GizWits_D2W_Resend_AckCmdHandle(void);
-uint8_t GizWits_W2D_AckCmdHandle(void);
-uint8_t GizWits_MessageHandle(uint8_t * Message_Buf, uint8_t Length); 
+uint16_t Pro_DupHash(const uint8_t *buf, uint16_t len);
+void GizWits_TimerInit(void);
+uint16_t Pro_ReportAttr_Delta(const Pro_ReportAttrTypeDef *attr, const uint8_t *cur, const uint8_t *last);
 
 #endif
@@ -0,0 +1,1946 @@
+/********************************************************
+*
+* @file      [GizWitsStack.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     机智云 只为智能硬件而生
+*            Gizwits Smart Cloud  for Smart Products
+*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态
+*            www.gizwits.com
+*
+*********************************************************/
+#ifndef _GIZWITSSTACK_H
+#define _GIZWITSSTACK_H
+
+#include "GizWits.h"
+#include "GizUart.h"
+#include "GizLog.h"
+#include "GizTrace.h"
+
+/******************************************************
+* GizWits 协议栈
+*   GizWits<P0Read, P0Write, Transport, Handler>
+* P0Read   : 上报的P0结构(设备状态)，状态快照及上报帧按其长度分配
+* P0Write  : 控制P0结构(含属性标志)，接收缓冲区按其长度分配，更长的帧按长度错误丢弃
+* Transport: 传输策略，提供静态函数 Init/Read/RxPending/Send/SendV/Poll/TxIdle/RxOverflow
+*            及常量 RamSize，如 GizUart_Transport(USART中断驱动，主机上由 tools/host 实现)、
+*            GizStream_Transport<SoftwareSerial, mySerial>(GizStream.h)
+* Handler  : 回调策略，提供静态函数 WiFiStatus(uint16_t)、ReadStatus 及 StreamBegin/StreamChunk/StreamEnd，
+*            默认 GizWits_NoHandler；
+*            可由 GizWits_NoHandler 派生，只定义需要的回调
+*
+* 收到的帧按命令字查表分发(见 GizWits.h 命令分发表)，厂商自定义命令用 RegisterCmd 登记，
+* 无需修改协议栈。
+* 控制命令收到后立即回复ACK并放入控制队列，sketch 在执行器空闲时用 ControlGet 逐条取出，
+* 执行器动作再慢也不会推迟心跳、ACK等协议帧；队列满时不回复ACK，由模组超时重发。
+* 模组重发的相同控制帧由重复帧缓存识别，只回复ACK，不会再执行一次。
+* 协议栈按模组的WiFi状态通知跟踪云端连接：未连接云端时不主动上报，已发出的上报不再重发，
+* 重新连接时只上报一次最新状态。
+* 透传等P0帧(如定时表、灯效)按块交给 Handler，长于接收缓冲区时边收边交，
+* 发送时由生成函数按块提供数据，都不需要整帧大小的RAM。
+* 传输和回调在编译时绑定，调用直接展开，不经函数指针。
+* 每个实例有独立的解析状态、ACK窗口、SN及上报状态，可在不同串口上同时运行多个实例；
+* 同一个传输策略只能由一个实例使用。调试日志和 SystemTimeCount 为各实例共用。
+* 状态成员与原来的全局变量同名，供主机工具直接检查。
+********************************************************/
+struct GizWits_NoHandler
+{
+	static void WiFiStatus(uint16_t wifiStatue) {}
+
+	//读取设备状态时提供实时状态：Status 指向当前P0，Version 在状态改变时变化；返回0时回复最近一次上报的状态
+	template<typename P0>
+	static uint8_t ReadStatus(const P0 *&Status, uint16_t &Version) { return 0; }
+
+	//控制、读取以外的P0帧(如透传数据)：返回1时按块接收，0时拒绝(长帧按长度错误丢弃，短帧回复 Error_Other)；
+	//Len 为 Action 之后的数据长度
+	static uint8_t StreamBegin(uint8_t Action, uint16_t Len) { return 0; }
+	static void StreamChunk(uint16_t Offset, const uint8_t *Buf, uint8_t Len) {}
+	//Ok:1 校验和正确； 0 校验和错误或中途放弃，已收到的块应丢弃
+	static void StreamEnd(uint8_t Ok) {}
+};
+
+//协议栈以外计入RAM预算的调试缓冲区
+#if (DEBUG == 1)
+#define GIZ_RAM_LOG			GIZ_LOG_SIZE
+#else
+#define GIZ_RAM_LOG			0
+#endif
+#if (GIZ_TRACE == 1)
+#define GIZ_RAM_TRACE		GIZ_TRACE_SIZE
+#else
+#define GIZ_RAM_TRACE		0
+#endif
+
+template<typename P0Read, typename P0Write, typename Transport, typename Handler = GizWits_NoHandler>
+class GizWits
+{
+public:
+	static constexpr uint16_t	StatusFrameLen = sizeof(Pro_HeadPartP0CmdTypeDef) + sizeof(P0Read) + 1;	//状态上报/读取回复帧
+	static constexpr uint16_t	ControlFrameLen = sizeof(Pro_HeadPartP0CmdTypeDef) + sizeof(P0Write) + 1;	//控制帧，模组发来的最长帧
+	static constexpr uint16_t	Max_UartBuf = (ControlFrameLen > sizeof(Pro_W2D_WifiStatusTypeDef)) ?
+									ControlFrameLen : sizeof(Pro_W2D_WifiStatusTypeDef);				//可接收的最大帧长度
+
+	static constexpr uint8_t	StreamChunkLen = (Max_UartBuf - sizeof(Pro_HeadPartP0CmdTypeDef) < Pro_StreamChunk) ?
+									Max_UartBuf - sizeof(Pro_HeadPartP0CmdTypeDef) : Pro_StreamChunk;	//接收分块长度
+
+	static_assert(StatusFrameLen <= 255 && ControlFrameLen <= 255, "P0 frames must fit the 8-bit segment length");
+
+	//状态帧的长度字段，其对校验和的贡献在编译时算出
+	typedef Pro_FrameDesc<0, StatusFrameLen> Pro_D2W_StatusFrame;
+
+	//命令处理函数：收到的帧在 Stack.UART_HandleStruct.Message_Buf 中，返回值即 MessageHandle 的返回值
+	typedef uint8_t (*Pro_CmdFunc)(GizWits &Stack);
+
+	typedef struct
+	{
+		Pro_CmdFunc				Func;		//为NULL时只做长度检查和ACK
+		uint8_t					Flag;		//Pro_Cmd_AutoAck / Pro_Cmd_P0Action
+		uint8_t					MinLen;		//最短帧长(含校验和)，0:命令不可识别
+	}Pro_CmdEntryTypeDef;
+
+	GizWits(void);
+
+	void Init(void);
+	uint8_t RegisterCmd(uint8_t Cmd, Pro_CmdFunc Func, uint8_t Flag, uint8_t MinLen);
+	uint8_t MessageHandle(void);
+	uint8_t MessageHandle(P0Write &Message);
+	uint8_t ControlGet(P0Write &Message);
+	uint8_t ControlPending(void) { return (uint8_t)(Ctrl_Tail - Ctrl_Head); }
+	void DevStatusUpgrade(const P0Read &P0, uint32_t Time, uint8_t flag, uint8_t ConfigFlag);
+	void SetReportAttr(const Pro_ReportAttrTypeDef *Attr_P, uint8_t Attr_Num);
+	void D2WResetCmd(void);
+	void D2WConfigCmd(uint8_t WiFi_Mode);
+	const Pro_AckStatTypeDef *GetAckStat(void);
+	const Pro_RxStatTypeDef *GetRxStat(void);
+	uint8_t LinkOnline(void) { return Link_Online; }
+	uint8_t StreamSend(uint8_t Action, uint16_t Len, Pro_StreamGenFunc Gen, void *Arg);
+	uint8_t StreamTxBusy(void) { return Stream_State != Pro_StreamTx_Idle; }
+	uint8_t Pro_GetFrame(void);
+
+	//协议栈RAM：本实例、传输策略的缓冲区及调试缓冲区
+	static constexpr uint16_t RamUsed(void)
+	{
+		return sizeof(GizWits) + Transport::RamSize + GIZ_RAM_LOG + GIZ_RAM_TRACE;
+	}
+
+	/*协议栈状态*/
+	UART_HandleTypeDef			UART_HandleStruct;
+	Pro_RxStatTypeDef			Pro_RxStatStruct;
+	Pro_Wait_AckTypeDef			Wait_AckStruct[Send_Window];
+	Pro_AckStatTypeDef			Pro_AckStatStruct;
+	uint8_t						packageFlag;				//UART_HandleStruct 中有一帧尚未处理
+	uint8_t						SN;
+	uint8_t						Pro_TxBodyBusy;				//P0数据仍由发送中断直接读取的帧数，不为0时不能修改 DevStatus
+	uint16_t					Ack_SRtt8;					//SRtt * 8
+	uint16_t					Ack_RttVar4;				//RttVar * 4
+	uint32_t					Last_ReportTime;
+	uint32_t					Last_Report_10_Time;
+	uint32_t					Reset_TIMER;
+	uint8_t						Link_Online;				//模组已连接云端；尚未收到WiFi状态时按已连接处理
+
+	//按属性上报：属性表(PROGMEM)、未上报的变化位、各属性上次上报时间
+	const Pro_ReportAttrTypeDef	*Report_Attr;
+	uint8_t						Report_AttrNum;
+	uint8_t						Report_Force;
+	uint16_t					Report_Dirty;
+	uint32_t					Report_AttrTime[Report_MaxAttr];
+
+	//厂商自定义命令：命令字及其表项
+	uint8_t						Cmd_UserNum;
+	uint8_t						Cmd_UserCmd[Pro_UserCmdMax];
+	Pro_CmdEntryTypeDef			Cmd_User[Pro_UserCmdMax];
+
+	//已回复ACK、等待 sketch 执行的控制命令
+	uint8_t						Ctrl_Head;
+	uint8_t						Ctrl_Tail;
+	P0Write						Ctrl_Queue[Pro_CtrlQueueLen];
+
+	//最近接受的控制帧，识别模组的重发
+	Pro_DupTypeDef				Dup_Cache[Pro_DupCacheLen];
+	uint8_t						Dup_Next;					//下一个替换的位置
+
+	//分块发送的P0帧：帧头及已发出部分的校验和，数据由生成函数提供
+	Pro_StreamGenFunc			Stream_Gen;
+	void						*Stream_Arg;
+	uint16_t					Stream_Len;					//Action之后的数据长度
+	uint16_t					Stream_Offset;				//已发出的数据字节数
+	uint8_t						Stream_Head[sizeof(Pro_HeadPartP0CmdTypeDef)];
+	uint8_t						Stream_Sum;
+	uint8_t						Stream_State;				//Pro_StreamTxStateTypeDef
+	uint8_t						Stream_SendNum;				//已重发次数
+	uint32_t					Stream_SendTime;
+
+	/*帧缓冲区，写入时按所在区的长度检查*/
+	uint8_t						Rx_Buf[Max_UartBuf];		//接收帧
+	uint8_t						DevStatus[StatusFrameLen];	//状态快照及上报帧
+
+	//读取设备状态的回复帧(不含校验和)，按 Handler::ReadStatus 给出的版本缓存
+	uint8_t						Read_Frame[StatusFrameLen - 1];
+	uint8_t						Read_Sum;					//不含SN的校验和
+	uint8_t						Read_Valid;
+	uint16_t					Read_Version;
+
+private:
+	static const Pro_CmdEntryTypeDef Cmd_Table[Pro_CmdStdNum];
+
+	//标准命令表中的处理函数
+	static uint8_t Cmd_DeviceInfo(GizWits &Stack) { Stack.Pro_W2D_GetMcuInfo(); return 1; }
+	static uint8_t Cmd_P0(GizWits &Stack);
+	static uint8_t Cmd_WifiStatus(GizWits &Stack) { Stack.Pro_W2D_WifiStatusHandle(); return 1; }
+	static uint8_t Cmd_ResetDevice(GizWits &Stack) { Stack.Pr0_W2D_RequestResetDeviceHandle(); return 1; }
+	static uint8_t Cmd_ErrorPackage(GizWits &Stack) { Stack.Pro_W2D_ErrorCmdHandle(Error_Other, 1); return 1; }
+
+	uint8_t Pro_CmdDispatch(uint8_t Cmd);
+	//各P0 Action的最短帧长(含校验和)
+	static constexpr uint16_t Pro_P0ActionLen(uint8_t Action)
+	{
+		return Action == P0_W2D_Control_Devce_Action ? ControlFrameLen : sizeof(Pro_HeadPartP0CmdTypeDef) + 1;
+	}
+	uint8_t Pro_DupFind(uint8_t Cmd, uint8_t SN, uint16_t Hash);
+	void Pro_DupAdd(uint8_t Cmd, uint8_t SN, uint16_t Hash);
+	Pro_Wait_AckTypeDef *Pro_WaitAck_Alloc(void);
+	void Pro_Rtt_Update(uint32_t rtt);
+	uint8_t W2D_AckCmdHandle(void);
+	uint8_t D2W_Resend_AckCmdHandle(void);
+	static void Pro_UART_SendDone(void *arg);
+	static void Pro_UART_AckBodyDone(void *arg);
+	static void Pro_UART_BodyDone(void *arg);
+	static void Pro_StreamSendDone(void *arg);
+	void Pro_StreamPump(uint8_t Flush);
+	void Pro_StreamFinish(void) { if(Stream_State == Pro_StreamTx_Body) Pro_StreamPump(1); }
+	void Pro_StreamAck(void);
+	void Pro_StreamResend(void);
+	void Pro_UART_SendSeg(const uint8_t *Head, uint8_t HeadLen, const uint8_t *Body, uint8_t BodyLen, uint8_t Sum, Pro_Wait_AckTypeDef *Arg);
+	void Pro_UART_SendFrame(const uint8_t *Head, uint8_t HeadLen, const uint8_t *Body, uint8_t BodyLen, uint8_t Sum, uint8_t Tag);
+	void Pro_UART_SendBuf(uint8_t *Buf, uint16_t PackLen, uint8_t Tag);
+	uint8_t Pro_P0FrameSum(const uint8_t *Head, const uint8_t *P0);
+	void Pro_ParseAbort(UART_HandleTypeDef *uart);
+	void Pro_StreamStop(UART_HandleTypeDef *uart);
+	uint8_t Pro_StreamByte(UART_HandleTypeDef *uart, uint8_t value);
+	void Pro_P0Deliver(void);
+	uint8_t Pro_ParseByte(uint8_t value);
+	void Pro_W2D_GetMcuInfo(void);
+	void Pro_W2D_CommonCmdHandle(void);
+	void Pro_W2D_WifiStatusHandle(void);
+	void Pr0_W2D_RequestResetDeviceHandle(void);
+	void Pro_W2D_ErrorCmdHandle(Error_PacketsTypeDef Error_Type, uint8_t flag);
+	void Pro_D2W_ReportDevStatusHandle(void);
+	uint16_t Pro_ReportAttr_Scan(const uint8_t *P0_Buff);
+	void Pro_ReportAttr_Merge(const uint8_t *P0_Buff, uint16_t due);
+};
+
+#define GIZWITS_TEMPLATE	template<typename P0Read, typename P0Write, typename Transport, typename Handler>
+#define GIZWITS_CLASS		GizWits<P0Read, P0Write, Transport, Handler>
+
+GIZWITS_TEMPLATE
+GIZWITS_CLASS::GizWits(void)
+	: UART_HandleStruct(), Pro_RxStatStruct(), Wait_AckStruct(), Pro_AckStatStruct(),
+	  packageFlag(0), SN(0), Pro_TxBodyBusy(0), Ack_SRtt8(0), Ack_RttVar4(0),
+	  Last_ReportTime(0), Last_Report_10_Time(0), Reset_TIMER(0), Link_Online(1),
+	  Report_Attr(NULL), Report_AttrNum(0), Report_Force(0), Report_Dirty(0), Report_AttrTime(),
+	  Cmd_UserNum(0), Cmd_UserCmd(), Cmd_User(), Ctrl_Head(0), Ctrl_Tail(0), Ctrl_Queue(),
+	  Dup_Cache(), Dup_Next(0),
+	  Stream_Gen(NULL), Stream_Arg(NULL), Stream_Len(0), Stream_Offset(0), Stream_Head(), Stream_Sum(0),
+	  Stream_State(Pro_StreamTx_Idle), Stream_SendNum(0), Stream_SendTime(0),
+	  Rx_Buf(), DevStatus(), Read_Frame(), Read_Sum(0), Read_Valid(0), Read_Version(0)
+{
+	uint8_t i;
+
+	UART_HandleStruct.Message_Buf = Rx_Buf;
+	Pro_AckStatStruct.Rto = Send_MaxTime;
+	for(i = 0; i < Send_Window; i++)
+	{
+		Wait_AckStruct[i].Owner = this;
+	}
+}
+
+/******************************************************
+* 标准命令表，下标为命令字
+* 只列出模组发往设备的命令；设备发出的命令字收到时按不可识别处理
+********************************************************/
+#define Pro_MinFrameLen		(sizeof(Pro_HeadPartTypeDef) + 1)
+
+GIZWITS_TEMPLATE
+const typename GIZWITS_CLASS::Pro_CmdEntryTypeDef GIZWITS_CLASS::Cmd_Table[Pro_CmdStdNum] PROGMEM =
+{
+	/*0x00*/								{NULL,				0,					0},
+	/*Pro_W2D_GetDeviceInfo_Cmd*/			{Cmd_DeviceInfo,	0,					Pro_MinFrameLen},
+	/*0x02*/								{NULL,				0,					0},
+	/*Pro_W2D_P0_Cmd*/						{Cmd_P0,			Pro_Cmd_P0Action,	sizeof(Pro_HeadPartP0CmdTypeDef) + 1},
+	/*0x04*/								{NULL,				0,					0},
+	/*0x05*/								{NULL,				0,					0},
+	/*Pro_W2D_P0_Ack_Cmd*/					{NULL,				0,					Pro_MinFrameLen},
+	/*Pro_W2D_Heartbeat_Cmd*/				{NULL,				Pro_Cmd_AutoAck,	Pro_MinFrameLen},
+	/*0x08*/								{NULL,				0,					0},
+	/*0x09*/								{NULL,				0,					0},
+	/*Pro_W2D_ControlWifi_Config_Ack_Cmd*/	{NULL,				0,					Pro_MinFrameLen},
+	/*0x0B*/								{NULL,				0,					0},
+	/*Pro_W2D_ResetWifi_Ack_Cmd*/			{NULL,				0,					Pro_MinFrameLen},
+	/*Pro_W2D_ReportWifiStatus_Cmd*/		{Cmd_WifiStatus,	Pro_Cmd_AutoAck,	sizeof(Pro_W2D_WifiStatusTypeDef)},
+	/*0x0E*/								{NULL,				0,					0},
+	/*Pro_W2D_ReportMCUReset_Cmd*/			{Cmd_ResetDevice,	Pro_Cmd_AutoAck,	Pro_MinFrameLen},
+	/*0x10*/								{NULL,				0,					0},
+	/*Pro_W2D_ErrorPackage_Cmd*/			{Cmd_ErrorPackage,	0,					sizeof(Pro_ErrorCmdTypeDef)},
+};
+
+#undef Pro_MinFrameLen
+
+/*******************************************************************************
+* Function Name  : RegisterCmd
+* Description    : 登记厂商自定义命令，已登记的命令字替换原表项
+* Input          : Cmd:命令字，不小于 Pro_CmdStdNum； Func:处理函数，可为NULL；
+*                  Flag:Pro_Cmd_AutoAck 或0； MinLen:最短帧长(含校验和)，不小于帧头加校验和
+* Output         : None
+* Return         : 1:成功； 0:命令字属于标准表、长度非法或表已满
+* Attention		   : 标准命令不能替换，以保证其查表不需额外比较
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::RegisterCmd(uint8_t Cmd, Pro_CmdFunc Func, uint8_t Flag, uint8_t MinLen)
+{
+	uint8_t i;
+
+	if(Cmd < Pro_CmdStdNum || MinLen < sizeof(Pro_HeadPartTypeDef) + 1 || MinLen > Max_UartBuf)
+	{
+		return 0;
+	}
+	for(i = 0; i < Cmd_UserNum; i++)
+	{
+		if(Cmd_UserCmd[i] == Cmd)
+		{
+			break;
+		}
+	}
+	if(i == Pro_UserCmdMax)
+	{
+		return 0;
+	}
+	if(i == Cmd_UserNum)
+	{
+		Cmd_UserNum++;
+	}
+	Cmd_UserCmd[i] = Cmd;
+	Cmd_User[i].Func = Func;
+	Cmd_User[i].Flag = Flag;
+	Cmd_User[i].MinLen = MinLen;
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_WaitAck_Alloc
+* Description    : 为需等待ACK的帧在窗口中分配一项
+* Input          : None
+* Output         : None
+* Return         : 窗口项； 窗口已满且没有可替换的上报帧时返回NULL
+* Attention		   : 窗口满时放弃最早的一帧P0上报，新的状态上报会覆盖其内容
+*******************************************************************************/
+GIZWITS_TEMPLATE
+Pro_Wait_AckTypeDef *GIZWITS_CLASS::Pro_WaitAck_Alloc(void)
+{
+	Pro_Wait_AckTypeDef *oldest = NULL;
+	Pro_HeadPartTypeDef *head;
+	uint8_t i;
+
+	for(i = 0; i < Send_Window; i++)
+	{
+		if(Wait_AckStruct[i].Flag == 0)
+		{
+			return &Wait_AckStruct[i];
+		}
+		head = (Pro_HeadPartTypeDef *)Wait_AckStruct[i].Head;
+		if(head->Cmd == Pro_D2W_P0_Cmd && (oldest == NULL || (int32_t)(Wait_AckStruct[i].SendTime - oldest->SendTime) < 0))
+		{
+			oldest = &Wait_AckStruct[i];
+		}
+	}
+
+	if(oldest != NULL)
+	{
+		GIZ_LOG1(Log_AckWindowFull, ((Pro_HeadPartTypeDef *)oldest->Head)->SN);
+	}
+	return oldest;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_Rtt_Update
+* Description    : 用一次ACK往返时间更新SRtt/RttVar，并计算新的超时时间
+* Input          : rtt:发送完成到收到ACK的时间(ms)
+* Output         : None
+* Return         : None
+* Attention		   : 定点计算：Ack_SRtt8 = SRtt * 8，Ack_RttVar4 = RttVar * 4
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_Rtt_Update(uint32_t rtt)
+{
+	int16_t delta;
+	uint16_t rto;
+
+	if(rtt > Send_CapTime)
+	{
+		rtt = Send_CapTime;
+	}
+
+	if(Ack_SRtt8 == 0)
+	{
+		Ack_SRtt8 = rtt << 3;
+		Ack_RttVar4 = rtt << 1;
+	}
+	else
+	{
+		delta = (int16_t)rtt - (int16_t)(Ack_SRtt8 >> 3);
+		Ack_SRtt8 += delta;
+		if(delta < 0)
+		{
+			delta = -delta;
+		}
+		delta -= (Ack_RttVar4 >> 2);
+		Ack_RttVar4 += delta;
+	}
+
+	rto = (Ack_SRtt8 >> 3) + Ack_RttVar4;
+	if(rto < Send_MinTime)
+	{
+		rto = Send_MinTime;
+	}
+	if(rto > Send_CapTime)
+	{
+		rto = Send_CapTime;
+	}
+	Pro_AckStatStruct.SRtt = Ack_SRtt8 >> 3;
+	Pro_AckStatStruct.RttVar = Ack_RttVar4 >> 2;
+	Pro_AckStatStruct.Rto = rto;
+}
+
+/*******************************************************************************
+* Function Name  : GetAckStat
+* Description    : 读取ACK往返时间及重发统计
+* Input          : None
+* Output         : None
+* Return         : 统计数据
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+const Pro_AckStatTypeDef *GIZWITS_CLASS::GetAckStat(void)
+{
+	return &Pro_AckStatStruct;
+}
+
+/*******************************************************************************
+* Function Name  : GetRxStat
+* Description    : 读取串口接收及帧同步统计
+* Input          : None
+* Output         : None
+* Return         : 统计数据
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+const Pro_RxStatTypeDef *GIZWITS_CLASS::GetRxStat(void)
+{
+	Pro_RxStatStruct.Overflow_Num = Transport::RxOverflow();
+	return &Pro_RxStatStruct;
+}
+
+/*******************************************************************************
+* Function Name  : W2D_AckCmdHandle
+* Description    : 在窗口中查找与收到的ACK对应的帧(Cmd + 1 且 SN 相同)
+* Input          : None
+* Output         : None
+* Return         : 1:收到对应的ACK； 3:收到对应的ACK但超时； 4:不是等待中的ACK
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::W2D_AckCmdHandle(void)
+{
+    uint8_t i;
+    Pro_Wait_AckTypeDef * Wait_Ack;
+    Pro_HeadPartTypeDef * Wait_Ack_HeadPart;
+    Pro_HeadPartTypeDef * Recv_HeadPart = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+
+    for(i = 0; i < Send_Window; i++)
+    {
+        Wait_Ack = &Wait_AckStruct[i];
+        Wait_Ack_HeadPart = (Pro_HeadPartTypeDef *)Wait_Ack->Head;
+
+        //Flag = 1为检测ACK模式，符合对应ACK条件行判断操作 否则是其他cmd,直接跳过
+        if((Wait_Ack->Flag != 1) || (Wait_Ack_HeadPart->Cmd != (Recv_HeadPart->Cmd - 1)) || (Wait_Ack_HeadPart->SN != Recv_HeadPart->SN))
+        {
+            continue;
+        }
+
+        //最后一次重发在超时前仍在等待，它的ACK同样有效
+        Wait_Ack->Flag = 0;
+        //只用未重发过的帧采样，避免把重发帧的ACK算到前一次发送上
+        if(Wait_Ack->SendNum == 0)
+        {
+            Pro_Rtt_Update(SystemTimeCount - Wait_Ack->SendTime);
+        }
+        if((SystemTimeCount - Wait_Ack->SendTime) < Wait_Ack->Timeout)
+        {
+            Pro_AckStatStruct.Ack_Num++;
+            GIZ_LOG1(Log_AckOk, SystemTimeCount - Wait_Ack->SendTime);
+            return 1; //是收到了对应的ACK包
+        }
+        Pro_AckStatStruct.AckLate_Num++;
+        GIZ_LOG1(Log_AckLate, SystemTimeCount - Wait_Ack->SendTime);
+        return 3; //是收到了对应的ACK包 但超时
+    }
+
+    return 4;//放不做接收ACK处理
+}
+
+/*******************************************************************************
+* Function Name  : Pro_UART_SendDone
+* Description    : 需等待ACK的帧真正发送完毕后，从此刻开始计算ACK超时
+* Input          : arg:Pro_Wait_AckTypeDef
+* Output         : None
+* Return         : None
+* Attention		   : 由 Transport::Poll 在主循环中调用
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_SendDone(void *arg)
+{
+	Pro_Wait_AckTypeDef *wait_ack = (Pro_Wait_AckTypeDef *)arg;
+
+	if(wait_ack != NULL && wait_ack->Flag == 1)
+	{
+		wait_ack->SendTime = SystemTimeCount;
+	}
+}
+
+//带有未拷贝数据、等待ACK的帧发送完毕，释放对该数据的占用
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_AckBodyDone(void *arg)
+{
+	((GizWits *)((Pro_Wait_AckTypeDef *)arg)->Owner)->Pro_TxBodyBusy--;
+	Pro_UART_SendDone(arg);
+}
+
+//带有未拷贝数据、不等待ACK的帧发送完毕，arg 为协议栈实例
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_BodyDone(void *arg)
+{
+	((GizWits *)arg)->Pro_TxBodyBusy--;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_UART_SendSeg
+* Description    : 按 帧头 | 数据 | 校验和 三段发送，帧头和校验和拷入发送缓冲区，数据不拷贝
+* Input          : Head/HeadLen:帧头； Body/BodyLen:数据，可为空； Sum:校验和； Arg:等待ACK的窗口项，可为NULL
+* Output         : None
+* Return         : None
+* Attention		   : Body 在发送完成前不能修改，期间 Pro_TxBodyBusy 不为0
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_SendSeg(const uint8_t *Head, uint8_t HeadLen, const uint8_t *Body, uint8_t BodyLen, uint8_t Sum, Pro_Wait_AckTypeDef *Arg)
+{
+	GizUart_SegTypeDef seg[3];
+	uint8_t num = 0;
+
+	Pro_StreamFinish();
+	seg[num].Buf = Head;
+	seg[num].Len = HeadLen;
+	seg[num++].Type = GIZ_SEG_COPY;
+	if(BodyLen != 0)
+	{
+		seg[num].Buf = Body;
+		seg[num].Len = BodyLen;
+		seg[num++].Type = GIZ_SEG_REF;
+	}
+	seg[num].Buf = &Sum;
+	seg[num].Len = 1;
+	seg[num++].Type = GIZ_SEG_COPY;
+
+	if(BodyLen != 0)
+	{
+		if((Arg != NULL && Transport::SendV(seg, num, Pro_UART_AckBodyDone, Arg) != 0) ||
+			(Arg == NULL && Transport::SendV(seg, num, Pro_UART_BodyDone, this) != 0))
+		{
+			Pro_TxBodyBusy++;
+		}
+	}
+	else
+	{
+		Transport::SendV(seg, num, Pro_UART_SendDone, Arg);
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Pro_UART_SendFrame
+* Description    : 发送由帧头和数据两部分组成的一帧
+* Input          : Head/HeadLen:帧头(含Len/Cmd/SN)； Body/BodyLen:帧头之后的数据，可为空；
+*                  Sum:校验和，由调用者用编译时算好的帧头部分加上SN和数据算出；
+*                  Tag=0,不等待ACK；Tag=1,等待ACK
+* Output         : None
+* Return         : None
+* Attention		   : Body 不拷贝，需等待ACK时直到收到ACK或放弃重发前都不能修改；
+*                  Tag=1 时 HeadLen 不能超过 Send_HeadMax。
+*                  新的状态上报包含全部属性的最新值，发送时取代仍在等待ACK的旧上报
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_SendFrame(const uint8_t *Head, uint8_t HeadLen, const uint8_t *Body, uint8_t BodyLen, uint8_t Sum, uint8_t Tag)
+{
+	Pro_Wait_AckTypeDef *Wait_Ack = NULL;
+	uint8_t i;
+
+	if(Tag == 1 && HeadLen <= Send_HeadMax)
+	{
+		if(((Pro_HeadPartTypeDef *)Head)->Cmd == Pro_D2W_P0_Cmd)
+		{
+			for(i = 0; i < Send_Window; i++)
+			{
+				if(Wait_AckStruct[i].Flag == 1 && ((Pro_HeadPartTypeDef *)Wait_AckStruct[i].Head)->Cmd == Pro_D2W_P0_Cmd)
+				{
+					Wait_AckStruct[i].Flag = 0;
+				}
+			}
+		}
+		Wait_Ack = Pro_WaitAck_Alloc();
+	}
+	if(Wait_Ack != NULL)
+	{
+		Wait_Ack->SendTime = SystemTimeCount;
+		Wait_Ack->SendNum = 0;
+		Wait_Ack->Flag = 1;
+		Wait_Ack->Timeout = Pro_AckStatStruct.Rto;
+		Wait_Ack->HeadLen = HeadLen;
+		memcpy(Wait_Ack->Head, Head, HeadLen);
+		Wait_Ack->Body = Body;
+		Wait_Ack->BodyLen = BodyLen;
+		Wait_Ack->Sum = Sum;
+		Pro_AckStatStruct.Send_Num++;
+	}
+	Pro_UART_SendSeg(Head, HeadLen, Body, BodyLen, Sum, Wait_Ack);
+	GIZ_LOG3(Log_TxFrame, ((Pro_HeadPartTypeDef *)Head)->Cmd, ((Pro_HeadPartTypeDef *)Head)->SN, HeadLen + BodyLen + 1);
+}
+
+/*******************************************************************************
+* Function Name  : UART_SendBuf
+* Description    : 向串口发送数据帧
+* Input          : buf:数据起始地址； packLen:数据长度； tag=0,不等待ACK；tag=1,等待ACK；
+* Output         : None
+* Return         : None
+* Attention		   : Buf 的最后一个字节须为已算好的校验和；
+*                  若等待ACK，按照协议失败重发3次；帧放入发送队列后立即返回，
+*                  数据区出现FF时由串口发送中断在其后增加55。
+*                  不等待ACK时整帧拷贝；等待ACK时只保存前 Send_HeadMax 字节，
+*                  更长的帧其余部分直接引用 Buf，收到ACK前 Buf 不能修改
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_UART_SendBuf(uint8_t *Buf, uint16_t PackLen, uint8_t Tag)
+{
+    //若为主动上报需判断返回的ACK
+	if(Tag == 1 && PackLen > Send_HeadMax + 1)
+	{
+		Pro_UART_SendFrame(Buf, Send_HeadMax, Buf + Send_HeadMax, PackLen - Send_HeadMax - 1, Buf[PackLen - 1], 1);
+	}
+	else if(Tag == 1)
+	{
+		Pro_UART_SendFrame(Buf, PackLen - 1, NULL, 0, Buf[PackLen - 1], 1);
+	}
+	else
+	{
+		Pro_StreamFinish();
+		Transport::Send(Buf, PackLen, NULL, NULL);
+		Log_UART_SendBuf(Buf, PackLen);
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Init
+* Description    : 初始化串口、定时器及状态上报帧
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : P0帧的长度在编译时确定，之后上报和读取回复只改写Cmd、SN和Action
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Init(void)
+{
+	Pro_HeadPartP0CmdTypeDef *Pro_D2W_ReportStatusStruct = (Pro_HeadPartP0CmdTypeDef *)DevStatus;
+
+	static_assert(RamUsed() <= GIZ_RAM_BUDGET, "GizWits RAM over GIZ_RAM_BUDGET: shrink the P0 structs, Send_Window or GIZ_TRACE_SIZE");
+
+	//串口初始化，接收由传输策略完成
+	Transport::Init(9600);
+	//定时中断初始
+	GizWits_TimerInit();
+
+	GIZ_LOG2(Log_RamBudget, RamUsed(), GIZ_RAM_BUDGET);
+	memset(DevStatus, 0, sizeof(DevStatus));
+	Pro_D2W_ReportStatusStruct->Pro_HeadPart.Head[0] = 0xFF;
+	Pro_D2W_ReportStatusStruct->Pro_HeadPart.Head[1] = 0xFF;
+	Pro_D2W_ReportStatusStruct->Pro_HeadPart.Len = Pro_D2W_StatusFrame::Len;
+
+	//读取回复的帧头除SN外不变
+	memcpy(Read_Frame, DevStatus, sizeof(Pro_HeadPartP0CmdTypeDef));
+	Pro_D2W_ReportStatusStruct = (Pro_HeadPartP0CmdTypeDef *)Read_Frame;
+	Pro_D2W_ReportStatusStruct->Pro_HeadPart.Cmd = Pro_D2W_P0_Ack_Cmd;
+	Pro_D2W_ReportStatusStruct->Action = P0_D2W_ReadDevStatus_Action_ACK;
+	Read_Valid = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_P0FrameSum
+* Description    : P0帧的校验和
+* Input          : Head:状态帧的帧头(含Action)； P0:P0数据
+* Output         : None
+* Return         : 校验和
+* Attention		   : 长度字段部分在编译时算好，只累加Cmd、SN、Action和P0数据
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_P0FrameSum(const uint8_t *Head, const uint8_t *P0)
+{
+	const Pro_HeadPartP0CmdTypeDef *head = (const Pro_HeadPartP0CmdTypeDef *)Head;
+	const uint8_t *p0 = P0;
+	uint8_t sum = Pro_D2W_StatusFrame::HeadSum + head->Pro_HeadPart.Cmd + head->Pro_HeadPart.SN + head->Action;
+	uint8_t i;
+
+	for(i = 0; i < sizeof(P0Read); i++)
+	{
+		sum += p0[i];
+	}
+	return sum;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_ParseAbort
+* Description    : 放弃未完成的帧，回到寻找帧头状态，已收到的字节计入丢弃
+* Input          : uart:串口接收结构
+* Output         : None
+* Return         : None
+* Attention		   : 分块接收中的帧通知 Handler 放弃
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_ParseAbort(UART_HandleTypeDef *uart)
+{
+	Pro_StreamStop(uart);
+	Pro_RxStatStruct.Resync_Num++;
+	Pro_RxStatStruct.Drop_Num += uart->Parse_Count;
+	uart->Parse_State = Pro_Parse_Head1;
+	uart->Parse_Escape = 0;
+	uart->Parse_Count = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_StreamStop
+* Description    : 结束分块接收状态，未收完的帧通知 Handler::StreamEnd(0)
+* Input          : uart:串口接收结构
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_StreamStop(UART_HandleTypeDef *uart)
+{
+	if(uart->Parse_Stream == Pro_Stream_Recv)
+	{
+		Handler::StreamEnd(0);
+	}
+	uart->Parse_Stream = Pro_Stream_None;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_StreamByte
+* Description    : 长于接收缓冲区的帧：帧头照常写入 Message_Buf，数据写入帧头之后的分块，
+*                  每满 StreamChunkLen 字节交给 Handler::StreamChunk
+* Input          : uart:串口接收结构； value:长度低字节之后的一个字节(已去转义)
+* Output         : None
+* Return         : 1:继续接收； 0:帧已放弃
+* Attention		   : 只接收P0命令；Action 到达时由 Handler::StreamBegin 决定是否接收。
+*                  校验和字节到达时先交出最后一块，校验结果由 Pro_ParseByte 核对
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_StreamByte(UART_HandleTypeDef *uart, uint8_t value)
+{
+	uint8_t *chunk = uart->Message_Buf + sizeof(Pro_HeadPartP0CmdTypeDef);
+	uint16_t count = uart->Parse_Count;
+
+	if(count < sizeof(Pro_HeadPartP0CmdTypeDef))
+	{
+		uart->Message_Buf[count] = value;
+		if(count == offsetof(Pro_HeadPartTypeDef, Cmd) && value != Pro_W2D_P0_Cmd)
+		{
+			goto Reject;
+		}
+		if(count == offsetof(Pro_HeadPartP0CmdTypeDef, Action))
+		{
+			if(Handler::StreamBegin(value, uart->Parse_Len - sizeof(Pro_HeadPartP0CmdTypeDef) - 1) == 0)
+			{
+				goto Reject;
+			}
+			uart->Parse_Stream = Pro_Stream_Recv;
+			uart->Stream_Fill = 0;
+			uart->Stream_Offset = 0;
+		}
+		return 1;
+	}
+
+	if(count + 1 < uart->Parse_Len)
+	{
+		chunk[uart->Stream_Fill++] = value;
+		if(uart->Stream_Fill < StreamChunkLen)
+		{
+			return 1;
+		}
+	}
+	if(uart->Stream_Fill != 0)
+	{
+		Handler::StreamChunk(uart->Stream_Offset, chunk, uart->Stream_Fill);
+		uart->Stream_Offset += uart->Stream_Fill;
+		uart->Stream_Fill = 0;
+	}
+	return 1;
+
+Reject:
+	Pro_RxStatStruct.LenErr_Num++;
+	Pro_RxStatStruct.Drop_Num++;
+	Pro_ParseAbort(uart);
+	return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_ParseByte
+* Description    : 帧解析状态机，每次处理一个字节：去除0xFF后的0x55，边收边算校验和，
+*                  数据直接写入UART_HandleStruct.Message_Buf
+* Input          : value:串口收到的一个字节
+* Output         : None
+* Return         : 0:收到完整一帧； 1:帧未完成
+* Attention		   : 数据区出现FF FF视为新的帧头，重新开始解析；
+*                  长度字段非法的帧直接放弃，继续寻找下一个帧头；
+*                  超出接收缓冲区的P0帧由 Pro_StreamByte 分块接收
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_ParseByte(uint8_t value)
+{
+	UART_HandleTypeDef *uart = &UART_HandleStruct;
+
+	if(uart->Parse_State >= Pro_Parse_LenH)
+	{
+		if(uart->Parse_Escape)
+		{
+			uart->Parse_Escape = 0;
+			if(value == 0x55)
+			{
+				return 1; //转义字节，丢弃
+			}
+			if(value == 0xFF)
+			{
+				//FF FF 新帧头，之前未完成的部分(不含作为帧头的0xFF)丢弃
+				Pro_StreamStop(uart);
+				Pro_RxStatStruct.Resync_Num++;
+				Pro_RxStatStruct.Drop_Num += uart->Parse_Count - 1;
+				uart->Parse_State = Pro_Parse_LenH;
+				uart->Parse_Count = 2;
+				uart->Parse_Sum = 0;
+				return 1;
+			}
+		}
+		else if(value == 0xFF)
+		{
+			uart->Parse_Escape = 1;
+		}
+	}
+
+	switch(uart->Parse_State)
+	{
+		case Pro_Parse_Head1:
+			if(value == 0xFF)
+			{
+				uart->Parse_Count = 1;
+				uart->Parse_State = Pro_Parse_Head2;
+			}
+			else
+			{
+				Pro_RxStatStruct.Drop_Num++;
+			}
+			return 1;
+		case Pro_Parse_Head2:
+			if(value == 0xFF)
+			{
+				uart->Message_Buf[0] = 0xFF;
+				uart->Message_Buf[1] = 0xFF;
+				uart->Parse_Count = 2;
+				uart->Parse_Sum = 0;
+				uart->Parse_Escape = 0;
+				uart->Parse_Stream = Pro_Stream_None;
+				uart->Parse_State = Pro_Parse_LenH;
+			}
+			else
+			{
+				Pro_RxStatStruct.Drop_Num += 2;
+				uart->Parse_Count = 0;
+				uart->Parse_State = Pro_Parse_Head1;
+			}
+			return 1;
+		case Pro_Parse_LenH:
+			uart->Parse_Len = (uint16_t)value << 8;
+			uart->Parse_State = Pro_Parse_LenL;
+			break;
+		case Pro_Parse_LenL:
+			uart->Parse_Len = (uart->Parse_Len | value) + 4;
+			//长度不足一个最短帧(含超过16位回绕)，丢弃此帧；超出缓存的帧等命令字及Action到达后再决定
+			if(uart->Parse_Len < sizeof(Pro_HeadPartTypeDef) + 1)
+			{
+				Pro_RxStatStruct.LenErr_Num++;
+				Pro_RxStatStruct.Drop_Num++;
+				Pro_ParseAbort(uart);
+				return 1;
+			}
+			if(uart->Parse_Len > Max_UartBuf)
+			{
+				uart->Parse_Stream = Pro_Stream_Wait;
+			}
+			uart->Parse_State = Pro_Parse_Body;
+			break;
+		default:
+			break;
+	}
+
+	if(uart->Parse_Stream == Pro_Stream_None)
+	{
+		uart->Message_Buf[uart->Parse_Count] = value;
+	}
+	else if(Pro_StreamByte(uart, value) == 0)
+	{
+		return 1;
+	}
+	uart->Parse_Count++;
+	if(uart->Parse_Count < uart->Parse_Len || uart->Parse_State != Pro_Parse_Body)
+	{
+		uart->Parse_Sum += value;
+		return 1;
+	}
+
+	//最后一个字节为校验和
+	uart->Message_Len = uart->Parse_Len;
+	uart->Parse_SumOk = (uart->Parse_Sum == value);
+	uart->Parse_State = Pro_Parse_Head1;
+	uart->Parse_Escape = 0;
+	uart->Parse_Count = 0;
+	Pro_RxStatStruct.Frame_Num++;
+	if(uart->Parse_Stream != Pro_Stream_None)
+	{
+		//数据已分块交出，留给分发的只有帧头和Action
+		GIZ_LOG3(Log_StreamRx, uart->Message_Buf[5], uart->Parse_Len, uart->Parse_SumOk);
+		uart->Message_Len = sizeof(Pro_HeadPartP0CmdTypeDef) + 1;
+		uart->Parse_Stream = Pro_Stream_Done;
+		Handler::StreamEnd(uart->Parse_SumOk);
+	}
+	if(uart->Parse_SumOk == 0)
+	{
+		Pro_RxStatStruct.SumErr_Num++;
+		//帧内丢了字节时，当作校验和的往往是下一帧帧头的第一个0xFF
+		if(value == 0xFF)
+		{
+			uart->Parse_Count = 1;
+			uart->Parse_State = Pro_Parse_Head2;
+		}
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_GetFrame
+* Description    : 取出传输策略中所有可读字节并解析，直到得到完整一帧
+* Input          : None
+* Output         : None
+* Return         : 0:收到完整一帧(packageFlag = 1)； 1:暂无完整帧
+* Attention		   : 上一帧未处理完(packageFlag = 1)时不再读取，剩余字节留在接收缓冲区；
+*                  接收缓冲区已取空且距上一个字节超过 Frame_GapTime 时放弃未完成的帧
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_GetFrame(void)
+{
+    uint8_t value;
+    uint8_t got = 0;
+    UART_HandleTypeDef *uart = &UART_HandleStruct;
+
+    if(packageFlag)
+    {
+        return 0;
+    }
+
+    while(Transport::Read(&value))
+    {
+        got = 1;
+        if(Pro_ParseByte(value) == 0)
+        {
+            uart->Parse_Time = (uint16_t)SystemTimeCount;
+#ifdef PROTOCOL_DEBUG
+            GIZ_LOG3(Log_RxFrame, uart->Message_Buf[4], uart->Message_Buf[5], uart->Message_Len);
+#endif
+            packageFlag = 1;
+            return 0;
+        }
+    }
+
+    if(got)
+    {
+        uart->Parse_Time = (uint16_t)SystemTimeCount;
+    }
+    else if(uart->Parse_State != Pro_Parse_Head1 && (uint16_t)((uint16_t)SystemTimeCount - uart->Parse_Time) > Frame_GapTime)
+    {
+        Pro_RxStatStruct.Timeout_Num++;
+        Pro_ParseAbort(uart);
+    }
+	return 1;
+
+}
+
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::D2W_Resend_AckCmdHandle(void)
+{
+	uint8_t i;
+	uint8_t ret = 0;
+	Pro_Wait_AckTypeDef *Wait_Ack;
+
+	//超时及放弃接收ACK，窗口中每一帧独立计时
+	for(i = 0; i < Send_Window; i++)
+	{
+		Wait_Ack = &Wait_AckStruct[i];
+		if(Wait_Ack->Flag != 1)
+		{
+			continue;
+		}
+        if((SystemTimeCount - Wait_Ack->SendTime) <= Wait_Ack->Timeout)
+        {
+            continue;
+        }
+        if(Wait_Ack->SendNum < Send_MaxNum)
+        {
+            //需重发，按实际帧长发送，超时时间指数退避
+            Pro_UART_SendSeg(Wait_Ack->Head, Wait_Ack->HeadLen, Wait_Ack->Body, Wait_Ack->BodyLen, Wait_Ack->Sum, Wait_Ack);
+            Wait_Ack->SendTime = SystemTimeCount;
+            Wait_Ack->SendNum++;
+            Wait_Ack->Timeout = (Wait_Ack->Timeout >= Send_CapTime / 2) ? Send_CapTime : (Wait_Ack->Timeout << 1);
+            Pro_AckStatStruct.Resend_Num++;
+			GIZ_LOG2(Log_Resend, ((Pro_HeadPartTypeDef *)Wait_Ack->Head)->SN, Wait_Ack->SendNum);
+            ret = 2; //重发包 等待接收ACK
+        }
+        else
+        {
+            //最后一次重发也已超时
+            Wait_Ack->Flag = 0;
+            Pro_AckStatStruct.GiveUp_Num++;
+            if(ret == 0)
+            {
+                ret = 1; //结束重发Ack机制
+            }
+        }
+	}
+	return ret;
+}
+
+/*******************************************************************************
+* Function Name  : MessageHandle
+* Description    : 主循环中调用：收发、重发及处理模组发来的一帧
+* Input          : None
+* Output         : None
+* Return         : 0:收到控制命令并已放入控制队列； 2:校验和错误； 1:其他；
+*                  自定义命令为其处理函数的返回值
+* Attention		   : 控制命令由 ControlGet 取出
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::MessageHandle(void)
+{
+    Pro_HeadPartTypeDef * Recv_HeadPart = NULL;
+    uint8_t ret = 0;
+    uint8_t idle = (Transport::RxPending() == 0 && Transport::TxIdle());
+
+    //空闲时输出一段串口收发记录，导出进行中时日志暂缓，免得夹进导出内容
+    if(GizTrace_DumpPoll(idle) == 0)
+    {
+        //空闲时输出一条调试日志
+        GizLog_Drain(idle);
+    }
+
+    //通知已发送完成的帧
+    Transport::Poll();
+
+    //抓取一包
+    Pro_GetFrame();
+
+	//ACK超时重发机制
+	ret = D2W_Resend_AckCmdHandle();
+	if(ret == 1)
+	{
+		GIZ_LOG(Log_GiveUp);
+	}
+	Pro_StreamResend();
+
+	//分块发送：发送队列空闲时再发一块
+	Pro_StreamPump(0);
+
+    if(packageFlag)
+    {
+        //验证校验码(解析时已累加)
+        if(UART_HandleStruct.Parse_SumOk == 0)
+		{
+            Pro_W2D_ErrorCmdHandle(Error_AckSum, 0);
+			packageFlag = 0;
+			return 2;
+		}
+
+		//检测返回ACK状态，结果在其中记入日志
+		W2D_AckCmdHandle();
+		Pro_StreamAck();
+
+		Recv_HeadPart = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+		ret = Pro_CmdDispatch(Recv_HeadPart->Cmd);
+        packageFlag = 0;
+		return ret;
+	}
+
+    return 1;
+}
+
+/*******************************************************************************
+* Function Name  : MessageHandle
+* Description    : 处理协议，并立即取出一条控制命令，用于动作很快的执行器
+* Input          : None
+* Output         : Message:取出的控制命令的P0数据
+* Return         : 0:取出了控制命令； 其他同 MessageHandle(void)
+* Attention		   : Message 只在返回0时改变
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::MessageHandle(P0Write &Message)
+{
+	uint8_t ret = MessageHandle();
+
+	if(ControlGet(Message))
+	{
+		return 0;
+	}
+	return (ret == 0) ? 1 : ret;
+}
+
+/*******************************************************************************
+* Function Name  : ControlGet
+* Description    : 从控制队列取出最早的一条控制命令
+* Input          : None
+* Output         : Message:控制命令的P0数据
+* Return         : 1:取出一条； 0:队列为空
+* Attention		   : 在执行器空闲、可以开始下一项动作时调用
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::ControlGet(P0Write &Message)
+{
+	if(Ctrl_Head == Ctrl_Tail)
+	{
+		return 0;
+	}
+	Message = Ctrl_Queue[Ctrl_Head & (Pro_CtrlQueueLen - 1)];
+	Ctrl_Head++;
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_CmdDispatch
+* Description    : 按命令字查表：检查帧长、按需回复ACK，再调用处理函数
+* Input          : Cmd:收到的命令字
+* Output         : None
+* Return         : 处理函数的返回值； 没有处理函数或帧被拒绝时返回1
+* Attention		   : 标准命令只查一次 PROGMEM 表，与命令数无关
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_CmdDispatch(uint8_t Cmd)
+{
+	Pro_CmdEntryTypeDef entry;
+	uint8_t i;
+
+	if(Cmd < Pro_CmdStdNum)
+	{
+		memcpy_P(&entry, &Cmd_Table[Cmd], sizeof(entry));
+	}
+	else
+	{
+		entry.MinLen = 0;
+		for(i = 0; i < Cmd_UserNum; i++)
+		{
+			if(Cmd_UserCmd[i] == Cmd)
+			{
+				entry = Cmd_User[i];
+				break;
+			}
+		}
+	}
+
+	if(entry.MinLen == 0)
+	{
+		Pro_W2D_ErrorCmdHandle(Error_Cmd, 0);
+		return 1;
+	}
+	if(UART_HandleStruct.Message_Len < entry.MinLen ||
+		((entry.Flag & Pro_Cmd_P0Action) && UART_HandleStruct.Parse_Stream != Pro_Stream_Done &&
+		 UART_HandleStruct.Message_Len < Pro_P0ActionLen(UART_HandleStruct.Message_Buf[sizeof(Pro_HeadPartTypeDef)])))
+	{
+		Pro_RxStatStruct.LenErr_Num++;
+		Pro_W2D_ErrorCmdHandle(Error_Other, 0);
+		return 1;
+	}
+	if(entry.Flag & Pro_Cmd_AutoAck)
+	{
+		Pro_W2D_CommonCmdHandle();
+	}
+	if(entry.Func == NULL)
+	{
+		return 1;
+	}
+	return entry.Func(*this);
+}
+
+/*******************************************************************************
+* Function Name  : Pro_DupFind
+* Description    : 在重复帧缓存中查找 Pro_DupTime 内接受过的相同控制帧
+* Input          : Cmd:命令字； SN:序号； Hash:P0数据的校验值
+* Output         : None
+* Return         : 1:重复； 0:新的帧
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Pro_DupFind(uint8_t Cmd, uint8_t SN, uint16_t Hash)
+{
+	uint16_t now = (uint16_t)SystemTimeCount;
+	uint8_t i;
+
+	for(i = 0; i < Pro_DupCacheLen; i++)
+	{
+		if(Dup_Cache[i].Cmd == Cmd && Dup_Cache[i].SN == SN && Dup_Cache[i].Hash == Hash &&
+			(uint16_t)(now - Dup_Cache[i].Time) < Pro_DupTime)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_DupAdd
+* Description    : 记录一个已接受的控制帧，依次替换最早的记录
+* Input          : Cmd:命令字； SN:序号； Hash:P0数据的校验值
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_DupAdd(uint8_t Cmd, uint8_t SN, uint16_t Hash)
+{
+	Pro_DupTypeDef *dup = &Dup_Cache[Dup_Next];
+
+	dup->Cmd = Cmd;
+	dup->SN = SN;
+	dup->Hash = Hash;
+	dup->Time = (uint16_t)SystemTimeCount;
+	Dup_Next = (Dup_Next + 1 == Pro_DupCacheLen) ? 0 : Dup_Next + 1;
+}
+
+/*******************************************************************************
+* Function Name  : Cmd_P0
+* Description    : 模组发来的P0命令：控制设备、读取设备状态，其他 Action 交给 Handler
+* Input          : Stack:协议栈实例
+* Output         : None
+* Return         : 0:控制命令已放入控制队列； 1:其他
+* Attention		   : 各 Action 的帧长已由命令分发按 Pro_P0ActionLen 检查；
+*                  控制队列满时不回复ACK，模组超时重发时再接收；
+*                  重复的控制帧只回复ACK；分块接收的帧数据已交给 Handler，只回复ACK
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::Cmd_P0(GizWits &Stack)
+{
+	uint8_t *buf = Stack.UART_HandleStruct.Message_Buf;
+	Pro_HeadPartTypeDef *head = (Pro_HeadPartTypeDef *)buf;
+	uint16_t hash;
+
+	if(Stack.UART_HandleStruct.Parse_Stream == Pro_Stream_Done)
+	{
+		Stack.Pro_W2D_CommonCmdHandle();
+		return 1;
+	}
+
+	switch(buf[sizeof(Pro_HeadPartTypeDef)])
+	{
+		case P0_W2D_Control_Devce_Action:
+			hash = Pro_DupHash(buf + sizeof(Pro_HeadPartTypeDef), Stack.UART_HandleStruct.Message_Len - sizeof(Pro_HeadPartTypeDef) - 1);
+			if(Stack.Pro_DupFind(head->Cmd, head->SN, hash))
+			{
+				Stack.Pro_RxStatStruct.Dup_Num++;
+				GIZ_LOG1(Log_CtrlDup, head->SN);
+				Stack.Pro_W2D_CommonCmdHandle();
+				break;
+			}
+			if((uint8_t)(Stack.Ctrl_Tail - Stack.Ctrl_Head) >= Pro_CtrlQueueLen)
+			{
+				Stack.Pro_RxStatStruct.Busy_Num++;
+				GIZ_LOG1(Log_CtrlBusy, head->SN);
+				break;
+			}
+			Stack.Pro_W2D_CommonCmdHandle();
+			//帧长已检查为完整的控制帧，拷贝的都是本帧数据
+			memcpy((uint8_t *)&Stack.Ctrl_Queue[Stack.Ctrl_Tail & (Pro_CtrlQueueLen - 1)], buf + sizeof(Pro_HeadPartP0CmdTypeDef), sizeof(P0Write));
+			Stack.Ctrl_Tail++;
+			Stack.Pro_DupAdd(head->Cmd, head->SN, hash);
+			return 0;
+		case P0_W2D_ReadDevStatus_Action:
+			Stack.Pro_D2W_ReportDevStatusHandle();
+			break;
+		default:
+			Stack.Pro_P0Deliver();
+			break;
+	}
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_P0Deliver
+* Description    : 整帧收在接收缓冲区中的其他P0帧(如短的透传数据)，
+*                  按与分块接收相同的 Begin/Chunk/End 交给 Handler 并回复ACK
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : Handler::StreamBegin 拒绝时回复 Error_Other；校验和已在分发前核对
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_P0Deliver(void)
+{
+	const uint8_t *buf = UART_HandleStruct.Message_Buf + sizeof(Pro_HeadPartP0CmdTypeDef);
+	uint16_t len = UART_HandleStruct.Message_Len - sizeof(Pro_HeadPartP0CmdTypeDef) - 1;
+	uint16_t offset;
+	uint8_t n;
+
+	if(Handler::StreamBegin(UART_HandleStruct.Message_Buf[sizeof(Pro_HeadPartTypeDef)], len) == 0)
+	{
+		Pro_W2D_ErrorCmdHandle(Error_Other, 0);
+		return;
+	}
+	for(offset = 0; offset < len; offset += n)
+	{
+		n = (len - offset > StreamChunkLen) ? StreamChunkLen : (uint8_t)(len - offset);
+		Handler::StreamChunk(offset, buf + offset, n);
+	}
+	Handler::StreamEnd(1);
+	Pro_W2D_CommonCmdHandle();
+}
+
+/*******************************************************************************
+* Function Name  : Pro_GetMcuInfo
+* Description    : WiFi模组请求设备信息
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_W2D_GetMcuInfo(void)
+{
+	Pro_HeadPartTypeDef *Recv_HeadPart = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+	Pro_HeadPartTypeDef head;
+	GizUart_SegTypeDef seg[3];
+	uint8_t sum;
+
+	//帧头和校验和拷入发送缓冲区，其余从 PROGMEM 发出
+	sum = Pro_FrameHead<Pro_D2W_DeviceInfoFrame>((uint8_t *)&head, Recv_HeadPart->SN) + Pro_InfoBodySum;
+	seg[0].Buf = (const uint8_t *)&head;
+	seg[0].Len = sizeof(head);
+	seg[0].Type = GIZ_SEG_COPY;
+	seg[1].Buf = Pro_InfoBody;
+	seg[1].Len = Pro_InfoBodyLen;
+	seg[1].Type = GIZ_SEG_PGM;
+	seg[2].Buf = &sum;
+	seg[2].Len = 1;
+	seg[2].Type = GIZ_SEG_COPY;
+	Pro_StreamFinish();
+	Transport::SendV(seg, 3, NULL, NULL);
+	Log_UART_SendBuf((uint8_t *)&head, Pro_D2W_DeviceInfoFrame::Size);
+}
+
+/*******************************************************************************
+
+* Function Name  : Pro_Pro_W2D_Heartbeat
+* Description    :
+* 1，WiFi模组与设备MCU的心跳(4.2)
+* 2，设备MCU通知WiFi模组进入配置模式(4.3)
+* 3，设备MCU重置WiFi模组(4.4)
+* 4, WiFi模组请求重启MCU(4.6)
+* 5, WiFi模组请求重启MCU ( 4.9 WiFi模组主动上报当前的状态)
+* 6，设备MCU回复 (WiFi模组控制设备)
+* 4.6 	WiFi模组请求重启MCU
+* 4.9 	Wifi模组回复
+* 4.10  设备MCU回复
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_W2D_CommonCmdHandle(void)
+{
+	Pro_CommonCmdTypeDef Pro_CommonCmdStruct;
+	Pro_HeadPartTypeDef *Recv_HeadPart = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+
+	Pro_CommonCmdStruct.Sum = Pro_FrameHead<Pro_D2W_CommonAckFrame>((uint8_t *)&Pro_CommonCmdStruct, Recv_HeadPart->SN);
+	Pro_CommonCmdStruct.Pro_HeadPart.Cmd = Recv_HeadPart->Cmd + 1;
+	Pro_CommonCmdStruct.Sum += Pro_CommonCmdStruct.Pro_HeadPart.Cmd;
+	Pro_UART_SendBuf((uint8_t *)&Pro_CommonCmdStruct, sizeof(Pro_CommonCmdStruct), 0);
+
+}
+
+/*******************************************************************************
+* Function Name  : Pro_W2D_WifiStatusHandle
+* Description    : 更新云端连接状态，并把WiFi的状态交给 Handler::WiFiStatus
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : ACK已由分发表回复。
+*                  断开时撤回等待ACK的上报及尚未开始发送的分块帧，不再重发；
+*                  重新连接时下一次 DevStatusUpgrade 上报最新状态
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_W2D_WifiStatusHandle(void)
+{
+	Pro_W2D_WifiStatusTypeDef *Pro_W2D_WifiStatusStruct = (Pro_W2D_WifiStatusTypeDef *)UART_HandleStruct.Message_Buf;
+	uint8_t online = (Pro_W2D_WifiStatusStruct->Wifi_Status & Wifi_ConnClouds) != 0;
+	uint8_t i;
+
+	if(online != Link_Online)
+	{
+		Link_Online = online;
+		GIZ_LOG1(Log_Link, online);
+		if(online)
+		{
+			Report_Force = 1;
+		}
+		else
+		{
+			for(i = 0; i < Send_Window; i++)
+			{
+				if(Wait_AckStruct[i].Flag == 1 && ((Pro_HeadPartTypeDef *)Wait_AckStruct[i].Head)->Cmd == Pro_D2W_P0_Cmd)
+				{
+					Wait_AckStruct[i].Flag = 0;
+				}
+			}
+			//已发出帧头的分块帧须发完，之后由 Pro_StreamResend 撤回
+			if(Stream_State != Pro_StreamTx_Body)
+			{
+				Stream_State = Pro_StreamTx_Idle;
+			}
+		}
+	}
+
+    Handler::WiFiStatus(Pro_W2D_WifiStatusStruct->Wifi_Status);
+
+}
+
+/*******************************************************************************
+* Function Name  : Pr0_W2D_RequestResetDeviceHandle
+* Description    : WiFi模组请求复位设备MCU，MCU回复ACK，并执行设备复位
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : ACK已由分发表回复
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pr0_W2D_RequestResetDeviceHandle(void)
+{
+	GIZ_LOG(Log_ResetDevice);
+
+	//为了避免WiFi模组没有收到确认而重发指令而造成MCU多次重启， 故MCU回复WiFi模组后需等待600毫秒再进行重启
+	Reset_TIMER = SystemTimeCount;
+	if((SystemTimeCount - Reset_TIMER) > RESTDEV_TIMER)
+	{
+//		 resetFunc();//会使系统死机需验证
+	}
+/****************************MCU RESTART****************************/
+
+}
+
+/*******************************************************************************
+* Function Name  : Pro_W2D_ErrorCmdHandle
+* Description    : WiFi发送收到非法信息通知，设备MCU回复ACK，并执行相应的动作
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		 : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_W2D_ErrorCmdHandle(Error_PacketsTypeDef Error_Type, uint8_t flag)
+{
+	Pro_ErrorCmdTypeDef           	 Pro_ErrorCmdStruct;       //4.7 非法消息通知
+	Pro_ErrorCmdTypeDef				*Recv_ErrorCmd = (Pro_ErrorCmdTypeDef *)UART_HandleStruct.Message_Buf;
+
+    if(flag == 1)
+    {
+        goto Print_O;
+    }
+
+    Pro_ErrorCmdStruct.Sum = Pro_FrameHead<Pro_D2W_ErrorAckFrame>((uint8_t *)&Pro_ErrorCmdStruct, Recv_ErrorCmd->Pro_HeadPart.SN);
+    Pro_ErrorCmdStruct.Error_Packets = Error_Type;
+    Pro_ErrorCmdStruct.Sum += Error_Type;
+    Pro_UART_SendBuf((uint8_t *)&Pro_ErrorCmdStruct, sizeof(Pro_ErrorCmdStruct), 0);
+
+    GIZ_LOG1(Log_ErrorSent, Error_Type);
+
+    return;
+
+Print_O:
+	/*************************错误类型*****************************/
+	GIZ_LOG1(Log_ErrorAck, Recv_ErrorCmd->Error_Packets);
+}
+
+/*******************************************************************************
+* Function Name  : Pro_D2W_ReportDevStatusHandle
+* Description    : 回复模组读取设备状态的请求
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : Handler 提供实时状态时回复请求时刻的状态：版本未变时只改写SN和校验和，
+*                  缓存帧仍在发送而状态已变时直接拷贝当前状态发送。
+*                  否则回复最近一次上报的状态(DevStatus)
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_D2W_ReportDevStatusHandle(void)
+{
+	Pro_HeadPartP0CmdTypeDef *Pro_D2W_ReportStatusStruct = (Pro_HeadPartP0CmdTypeDef *)DevStatus;
+	Pro_HeadPartTypeDef *Recv_HeadPart = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+	Pro_HeadPartP0CmdTypeDef *head = (Pro_HeadPartP0CmdTypeDef *)Read_Frame;
+	const P0Read *live = NULL;
+	uint16_t version = 0;
+	GizUart_SegTypeDef seg[3];
+	uint8_t sum;
+
+	if(Handler::ReadStatus(live, version) == 0 || live == NULL)
+	{
+        //帧头其余部分在初始化时已写好
+        Pro_D2W_ReportStatusStruct->Pro_HeadPart.Cmd = Pro_D2W_P0_Ack_Cmd;
+        Pro_D2W_ReportStatusStruct->Pro_HeadPart.SN = Recv_HeadPart->SN;
+        Pro_D2W_ReportStatusStruct->Action = P0_D2W_ReadDevStatus_Action_ACK;
+		//帧头拷入发送缓冲区，状态数据直接从 DevStatus 发出
+		Pro_UART_SendFrame(DevStatus, sizeof(Pro_HeadPartP0CmdTypeDef), DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef), sizeof(P0Read), Pro_P0FrameSum(DevStatus, DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef)), 0);
+		return;
+	}
+
+	head->Pro_HeadPart.SN = Recv_HeadPart->SN;
+	if(Read_Valid == 0 || version != Read_Version)
+	{
+		if(Pro_TxBodyBusy != 0)
+		{
+			//缓存帧的数据仍由发送中断读取，不能改写，本次拷贝当前状态
+			sum = Pro_P0FrameSum(Read_Frame, (const uint8_t *)live);
+			seg[0].Buf = Read_Frame;
+			seg[0].Len = sizeof(Pro_HeadPartP0CmdTypeDef);
+			seg[0].Type = GIZ_SEG_COPY;
+			seg[1].Buf = (const uint8_t *)live;
+			seg[1].Len = sizeof(P0Read);
+			seg[1].Type = GIZ_SEG_COPY;
+			seg[2].Buf = &sum;
+			seg[2].Len = 1;
+			seg[2].Type = GIZ_SEG_COPY;
+			Pro_StreamFinish();
+			Transport::SendV(seg, 3, NULL, NULL);
+			GIZ_LOG3(Log_TxFrame, Pro_D2W_P0_Ack_Cmd, Recv_HeadPart->SN, StatusFrameLen);
+			return;
+		}
+		memcpy(Read_Frame + sizeof(Pro_HeadPartP0CmdTypeDef), live, sizeof(P0Read));
+		Read_Sum = Pro_P0FrameSum(Read_Frame, Read_Frame + sizeof(Pro_HeadPartP0CmdTypeDef)) - head->Pro_HeadPart.SN;
+		Read_Version = version;
+		Read_Valid = 1;
+	}
+	//帧头拷入发送缓冲区，状态数据直接从缓存帧发出
+	Pro_UART_SendFrame(Read_Frame, sizeof(Pro_HeadPartP0CmdTypeDef), Read_Frame + sizeof(Pro_HeadPartP0CmdTypeDef), sizeof(P0Read), (uint8_t)(Read_Sum + head->Pro_HeadPart.SN), 0);
+}
+
+/*******************************************************************************
+* Function Name  : StreamSend
+* Description    : 发送一帧长度不受P0结构限制的P0帧，数据由生成函数分块提供
+* Input          : Action:P0 Action，如 P0_D2W_Transparent_Action； Len:Action之后的数据长度；
+*                  Gen:数据生成函数； Arg:生成函数的参数
+* Output         : None
+* Return         : 1:已开始发送； 0:上一帧仍在发送或等待ACK、未连接云端或长度非法
+* Attention		   : 之后由 MessageHandle 在发送队列空闲时逐块发出；
+*                  收到ACK或放弃重发之前，Gen 对同一 Offset 必须给出相同的数据
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint8_t GIZWITS_CLASS::StreamSend(uint8_t Action, uint16_t Len, Pro_StreamGenFunc Gen, void *Arg)
+{
+	Pro_HeadPartP0CmdTypeDef *head = (Pro_HeadPartP0CmdTypeDef *)Stream_Head;
+
+	if(Stream_State != Pro_StreamTx_Idle || Link_Online == 0 || Gen == NULL ||
+		Len == 0 || Len > 0xFFFF - (sizeof(Pro_HeadPartP0CmdTypeDef) + 1 - 4))
+	{
+		return 0;
+	}
+	head->Pro_HeadPart.Head[0] = 0xFF;
+	head->Pro_HeadPart.Head[1] = 0xFF;
+	head->Pro_HeadPart.Len = (uint16_t)(Len + sizeof(Pro_HeadPartP0CmdTypeDef) + 1 - 4);
+	head->Pro_HeadPart.Cmd = Pro_D2W_P0_Cmd;
+	head->Pro_HeadPart.SN = SN++;
+	head->Pro_HeadPart.Flags[0] = 0;
+	head->Pro_HeadPart.Flags[1] = 0;
+	head->Action = Action;
+	Stream_Gen = Gen;
+	Stream_Arg = Arg;
+	Stream_Len = Len;
+	Stream_SendNum = 0;
+	Stream_State = Pro_StreamTx_Head;
+	Pro_AckStatStruct.Send_Num++;
+	Pro_StreamPump(0);
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_StreamPump
+* Description    : 发出分块帧的下一部分：先是帧头，之后每次一块，最后一块带上校验和
+* Input          : Flush:1 一直发到整帧发完； 0 只在发送队列空闲时发一部分
+* Output         : None
+* Return         : None
+* Attention		   : 每块拷入发送缓冲区，生成函数的缓冲区只在本函数的栈上；
+*                  帧头之后的各部分带 GIZ_SEG_CONT，由传输策略全部转义
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_StreamPump(uint8_t Flush)
+{
+	GizUart_SegTypeDef seg[2];
+	uint8_t buf[Pro_StreamChunk];
+	uint8_t len;
+	uint8_t i;
+
+	while(Stream_State == Pro_StreamTx_Head || Stream_State == Pro_StreamTx_Body)
+	{
+		if(Flush == 0 && Transport::TxIdle() == 0)
+		{
+			return;
+		}
+		if(Stream_State == Pro_StreamTx_Head)
+		{
+			Stream_Sum = 0;
+			for(i = 2; i < sizeof(Stream_Head); i++)
+			{
+				Stream_Sum += Stream_Head[i];
+			}
+			seg[0].Buf = Stream_Head;
+			seg[0].Len = sizeof(Stream_Head);
+			seg[0].Type = GIZ_SEG_COPY;
+			Transport::SendV(seg, 1, NULL, NULL);
+			GIZ_LOG3(Log_TxFrame, Pro_D2W_P0_Cmd, Stream_Head[5], Stream_Len + sizeof(Stream_Head) + 1);
+			Stream_Offset = 0;
+			Stream_State = Pro_StreamTx_Body;
+			continue;
+		}
+
+		len = (Stream_Len - Stream_Offset > Pro_StreamChunk) ? Pro_StreamChunk : (uint8_t)(Stream_Len - Stream_Offset);
+		Stream_Gen(Stream_Arg, Stream_Offset, buf, len);
+		for(i = 0; i < len; i++)
+		{
+			Stream_Sum += buf[i];
+		}
+		Stream_Offset += len;
+		seg[0].Buf = buf;
+		seg[0].Len = len;
+		seg[0].Type = GIZ_SEG_COPY | GIZ_SEG_CONT;
+		if(Stream_Offset < Stream_Len)
+		{
+			Transport::SendV(seg, 1, NULL, NULL);
+			continue;
+		}
+		seg[1].Buf = &Stream_Sum;
+		seg[1].Len = 1;
+		seg[1].Type = GIZ_SEG_COPY;
+		Stream_SendTime = SystemTimeCount;
+		Stream_State = Pro_StreamTx_Wait;
+		Transport::SendV(seg, 2, Pro_StreamSendDone, this);
+	}
+}
+
+//分块帧的最后一块发送完毕，从此刻开始计算ACK超时，arg 为协议栈实例
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_StreamSendDone(void *arg)
+{
+	GizWits *stack = (GizWits *)arg;
+
+	if(stack->Stream_State == Pro_StreamTx_Wait)
+	{
+		stack->Stream_SendTime = SystemTimeCount;
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Pro_StreamAck
+* Description    : 收到的帧是否为等待中的分块帧的ACK
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_StreamAck(void)
+{
+	Pro_HeadPartTypeDef *recv = (Pro_HeadPartTypeDef *)UART_HandleStruct.Message_Buf;
+
+	if(Stream_State == Pro_StreamTx_Wait && recv->Cmd == Pro_W2D_P0_Ack_Cmd &&
+		recv->SN == ((Pro_HeadPartTypeDef *)Stream_Head)->SN)
+	{
+		Stream_State = Pro_StreamTx_Idle;
+		Pro_AckStatStruct.Ack_Num++;
+		GIZ_LOG1(Log_AckOk, SystemTimeCount - Stream_SendTime);
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Pro_StreamResend
+* Description    : 分块帧超时未收到ACK时从头重发，超时时间按次数加倍
+* Input          : None
+* Output         : None
+* Return         : None
+* Attention		   : 重发次数与其他帧相同(Send_MaxNum)；云端已断开时直接撤回
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_StreamResend(void)
+{
+	uint32_t timeout;
+
+	if(Stream_State != Pro_StreamTx_Wait)
+	{
+		return;
+	}
+	if(Link_Online == 0)
+	{
+		Stream_State = Pro_StreamTx_Idle;
+		return;
+	}
+	timeout = (uint32_t)Pro_AckStatStruct.Rto << Stream_SendNum;
+	if(timeout > Send_CapTime)
+	{
+		timeout = Send_CapTime;
+	}
+	if((SystemTimeCount - Stream_SendTime) <= timeout)
+	{
+		return;
+	}
+	if(Stream_SendNum >= Send_MaxNum)
+	{
+		Stream_State = Pro_StreamTx_Idle;
+		Pro_AckStatStruct.GiveUp_Num++;
+		GIZ_LOG(Log_GiveUp);
+		return;
+	}
+	Stream_SendNum++;
+	Stream_State = Pro_StreamTx_Head;
+	Pro_AckStatStruct.Resend_Num++;
+	GIZ_LOG2(Log_Resend, Stream_Head[5], Stream_SendNum);
+}
+
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::D2WResetCmd(void)
+{
+	Pro_CommonCmdTypeDef Pro_D2WReset;
+
+	Pro_D2WReset.Sum = Pro_FrameHead<Pro_D2W_ResetWifiFrame>((uint8_t *)&Pro_D2WReset, SN++);
+	Pro_UART_SendBuf((uint8_t *)&Pro_D2WReset, sizeof(Pro_CommonCmdTypeDef), 1); //最后一位为 4.3/4.4/4.9 的重发机制开关
+
+}
+
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::D2WConfigCmd(uint8_t WiFi_Mode)
+{
+	Pro_D2W_ConfigWifiTypeDef Pro_D2WConfigWiFiMode;
+
+	Pro_D2WConfigWiFiMode.Sum = Pro_FrameHead<Pro_D2W_ConfigWifiFrame>((uint8_t *)&Pro_D2WConfigWiFiMode, SN++);
+	Pro_D2WConfigWiFiMode.Config_Method = WiFi_Mode;
+	Pro_D2WConfigWiFiMode.Sum += WiFi_Mode;
+	Pro_UART_SendBuf((uint8_t *)&Pro_D2WConfigWiFiMode, sizeof(Pro_D2W_ConfigWifiTypeDef), 1); //最后一位为 4.3/4.4/4.9 的重发机制开关
+
+}
+
+/*******************************************************************************
+* Function Name  : SetReportAttr
+* Description    : 设置按属性上报的属性表，未设置时沿用整帧比较、2秒限频的上报方式
+* Input          : Attr_P:属性表(PROGMEM)； Attr_Num:项数，最多 Report_MaxAttr
+* Output         : None
+* Return         : None
+* Attention		   : 各属性的上次上报时间置为一个间隔之前，设置后的第一次变化立即上报
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::SetReportAttr(const Pro_ReportAttrTypeDef *Attr_P, uint8_t Attr_Num)
+{
+	uint8_t i;
+
+	Report_Attr = Attr_P;
+	Report_AttrNum = (Attr_Num > Report_MaxAttr) ? Report_MaxAttr : Attr_Num;
+	Report_Dirty = 0;
+	for(i = 0; i < Report_AttrNum; i++)
+	{
+		Report_AttrTime[i] = SystemTimeCount - pgm_read_word(&Attr_P[i].MinInterval);
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Pro_ReportAttr_Scan
+* Description    : 更新各属性的变化位，并找出此刻应当上报的属性
+* Input          : P0_Buff:当前P0
+* Output         : None
+* Return         : 应上报属性的位掩码，0表示无需上报
+* Attention		   : 回到死区以内的属性清除变化位；
+*                  有紧急属性上报时，尚未到间隔的普通属性变化一并带上，不再单独等到各自的间隔
+*******************************************************************************/
+GIZWITS_TEMPLATE
+uint16_t GIZWITS_CLASS::Pro_ReportAttr_Scan(const uint8_t *P0_Buff)
+{
+	Pro_ReportAttrTypeDef attr;
+	const uint8_t *last = DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef);
+	uint16_t due = 0;
+	uint8_t urgent = 0;
+	uint16_t delta;
+	uint16_t bit;
+	uint8_t i;
+
+	for(i = 0, bit = 1; i < Report_AttrNum; i++, bit <<= 1)
+	{
+		memcpy_P(&attr, &Report_Attr[i], sizeof(attr));
+		delta = Pro_ReportAttr_Delta(&attr, P0_Buff, last);
+		if(delta == 0 || delta < attr.Deadband)
+		{
+			Report_Dirty &= ~bit;
+			continue;
+		}
+		Report_Dirty |= bit;
+		if(attr.Class == Report_Urgent)
+		{
+			urgent = 1;
+			due |= bit;
+		}
+		else if(SystemTimeCount - Report_AttrTime[i] >= attr.MinInterval)
+		{
+			due |= bit;
+		}
+	}
+	if(urgent)
+	{
+		due |= Report_Dirty;
+	}
+	return due;
+}
+
+/*******************************************************************************
+* Function Name  : Pro_ReportAttr_Merge
+* Description    : 把到期属性的当前值写入上报缓存，其余属性保持上次上报的值
+* Input          : P0_Buff:当前P0； due:到期属性位掩码，0xFFFF 表示全部
+* Output         : None
+* Return         : None
+* Attention		   : None
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::Pro_ReportAttr_Merge(const uint8_t *P0_Buff, uint16_t due)
+{
+	Pro_ReportAttrTypeDef attr;
+	uint8_t *last = DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef);
+	uint16_t bit;
+	uint8_t i;
+
+	for(i = 0, bit = 1; i < Report_AttrNum; i++, bit <<= 1)
+	{
+		if(due & bit)
+		{
+			memcpy_P(&attr, &Report_Attr[i], sizeof(attr));
+			memcpy(last + attr.Offset, P0_Buff + attr.Offset, attr.Size);
+			Report_AttrTime[i] = SystemTimeCount;
+		}
+	}
+	Report_Dirty &= ~due;
+}
+
+/*******************************************************************************
+* Function Name  : DevStatusUpgrade
+* Description    : 按需主动上报设备状态
+* Input          : P0:当前状态； Time:定时上报周期(ms，按 Time * 60 计)；
+*                  flag:1 立即上报； ConfigFlag:1 配网中，不上报
+* Output         : None
+* Return         : None
+* Attention		   : 未连接云端时不上报，重新连接后上报一次最新状态
+*******************************************************************************/
+GIZWITS_TEMPLATE
+void GIZWITS_CLASS::DevStatusUpgrade(const P0Read &P0, uint32_t Time, uint8_t flag, uint8_t ConfigFlag)
+{
+	const uint8_t *P0_Buff = (const uint8_t *)&P0;
+	uint8_t Report_Flag = 0;
+	uint16_t Report_Due = 0xFFFF;
+	Pro_HeadPartP0CmdTypeDef *Pro_D2W_ReportStatusStruct = (Pro_HeadPartP0CmdTypeDef *)DevStatus;
+
+    //配网过程中不主动上报；未收到ACK的上报留在窗口中重发，不再阻塞新的上报
+  	if( ConfigFlag == 1 )
+	{
+        return;
+	}
+    if(flag == 1)
+    {
+        Report_Force = 1;
+    }
+    //未连接云端时不上报，需要上报的变化合并到重新连接后的一次上报中
+    if(Link_Online == 0)
+    {
+        return;
+    }
+    //上一帧状态数据仍由串口中断直接从 DevStatus 读取，推迟到下次调用
+    if(Pro_TxBodyBusy != 0)
+    {
+        return;
+    }
+    if(Report_Force == 1)
+    {
+        Report_Force = 0;
+        Report_Flag = 1;
+        goto Report;
+    }
+
+    if(Report_AttrNum != 0)
+    {
+        //按属性的死区、最小间隔及紧急级别决定是否上报
+        Report_Due = Pro_ReportAttr_Scan(P0_Buff);
+        if(Report_Due != 0)
+        {
+            Report_Flag = 1;
+        }
+    }
+    //设备的状态的变化是由于用户触发或环境变化所产生的， 其发送的频率不能快于2秒每次
+    else if((2 * 1000) < (SystemTimeCount - Last_ReportTime))
+    {
+        if(memcmp(DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef), P0_Buff, sizeof(P0Read)) != 0)
+        {
+            Report_Flag = 1;
+        }
+    }
+
+    //每隔十分钟定时主动上报
+    if((Time * 6 * 10) < (SystemTimeCount - Last_Report_10_Time))
+	{
+        GIZ_LOG(Log_Report10Min);
+		Report_Flag = 1;
+		Report_Due = 0xFFFF;
+        Last_Report_10_Time = SystemTimeCount;
+	}
+
+Report:
+	if(Report_Flag == 1)
+	{
+        if(Report_Due == 0xFFFF)
+        {
+            memcpy(DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef), P0_Buff, sizeof(P0Read));
+        }
+        Pro_ReportAttr_Merge(P0_Buff, Report_Due);
+
+        Pro_D2W_ReportStatusStruct->Pro_HeadPart.Cmd = Pro_D2W_P0_Cmd;
+        Pro_D2W_ReportStatusStruct->Pro_HeadPart.SN = SN++;
+        Pro_D2W_ReportStatusStruct->Action = P0_D2W_ReportDevStatus_Action;
+        //DevStatus 即上报快照，不再拷贝：重发时直接从此处发送，等待ACK期间只有新的上报会修改它
+        Pro_UART_SendFrame(DevStatus, sizeof(Pro_HeadPartP0CmdTypeDef), DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef), sizeof(P0Read), Pro_P0FrameSum(DevStatus, DevStatus + sizeof(Pro_HeadPartP0CmdTypeDef)), 1);//最后一位为 4.3/4.4/4.9 的重发机制开关
+
+        Last_ReportTime = SystemTimeCount;
+
+
+	}
+	return;
+}
+
+#undef GIZWITS_TEMPLATE
+#undef GIZWITS_CLASS
+
+#endif
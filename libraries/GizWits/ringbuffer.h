@@ -14,26 +14,199 @@
 #ifndef RINGBUFFER_H
 #define RINGBUFFER_H
 
-#include <stdlib.h>
-#include "GizWits.h"
-
-typedef struct {
-    size_t rb_capacity;
-    char  *rb_head;
-    char  *rb_tail;
-//  char rb_buff[256];
-    char rb_buff[128]; //MAX_P0_LEN
-}RingBuffer;
-
-// RingBuffer* rb_new(size_t capacity);
-void        rb_new(RingBuffer* rb);
-void        rb_free(RingBuffer *rb);
-
-size_t      rb_capacity(RingBuffer *rb);
-size_t      rb_can_read(RingBuffer *rb);
-size_t      rb_can_write(RingBuffer *rb);
-
-size_t      rb_read(RingBuffer *rb, void *data, size_t count);
-size_t      rb_write(RingBuffer *rb, const void *data, size_t count);
+#include <stdint.h>
+#include <string.h>
+
+/******************************************************
+* 单生产者/单消费者环形缓冲区
+* rb_tail 只由写方(如串口接收中断)修改，rb_head 只由读方修改，
+* 两者都是单字节，AVR上读写天然原子，不需要关中断。
+* 索引自由递增，取模由掩码完成，容量 N 的每个字节都可以用上；
+* N 由各实例分别给定，必须是2的幂且不超过128。
+* 串口接收、串口发送和日志各用一个实例，互不影响。
+*
+* 除逐字节的 rb_put/rb_get 和整段拷贝的 rb_write/rb_read 外，
+* rb_read_span/rb_write_span 给出可以直接读写的连续一段，
+* 处理完后用 rb_read_commit/rb_write_commit 提交实际的字节数，省去一次拷贝。
+* 数据在缓冲区末尾折回时连续段只到末尾为止，提交后再取一次即是折回的部分。
+********************************************************/
+//编译器内存屏障，保证数据写入先于索引更新
+#define RB_BARRIER()		__asm__ __volatile__("" ::: "memory")
+
+template<uint8_t N>
+struct RingBuffer
+{
+	static_assert(N != 0 && (N & (N - 1)) == 0 && N <= 128, "RingBuffer size must be a power of two no larger than 128");
+
+	static constexpr uint8_t	Size = N;
+	static constexpr uint8_t	Mask = N - 1;
+
+	volatile uint8_t rb_head;
+	volatile uint8_t rb_tail;
+	uint8_t rb_buff[N];
+};
+
+template<uint8_t N>
+inline void rb_new(RingBuffer<N> *rb)
+{
+	rb->rb_head = 0;
+	rb->rb_tail = 0;
+}
+
+template<uint8_t N>
+inline uint8_t rb_capacity(const RingBuffer<N> *rb)
+{
+	return N;
+}
+
+template<uint8_t N>
+inline uint8_t rb_can_read(const RingBuffer<N> *rb)
+{
+	return (uint8_t)(rb->rb_tail - rb->rb_head);
+}
+
+template<uint8_t N>
+inline uint8_t rb_can_write(const RingBuffer<N> *rb)
+{
+	return (uint8_t)(N - rb_can_read(rb));
+}
+
+/*******************************************************************************
+* Function Name  : rb_put
+* Description    : 写入一个字节，供中断服务程序使用
+* Return         : 1:写入成功； 0:缓冲区已满
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_put(RingBuffer<N> *rb, uint8_t value)
+{
+	uint8_t tail = rb->rb_tail;
+
+	if((uint8_t)(tail - rb->rb_head) >= N)
+		return 0;
+	rb->rb_buff[tail & RingBuffer<N>::Mask] = value;
+	RB_BARRIER();
+	rb->rb_tail = tail + 1;
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : rb_get
+* Description    : 读出一个字节
+* Return         : 1:读出成功； 0:缓冲区为空
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_get(RingBuffer<N> *rb, uint8_t *value)
+{
+	uint8_t head = rb->rb_head;
+
+	if(head == rb->rb_tail)
+		return 0;
+	*value = rb->rb_buff[head & RingBuffer<N>::Mask];
+	RB_BARRIER();
+	rb->rb_head = head + 1;
+	return 1;
+}
+
+/*******************************************************************************
+* Function Name  : rb_read
+* Description    : 读出最多 count 个字节，折回时分两次拷贝
+* Input          : count:要读的字节数
+* Output         : data:读出的数据
+* Return         : 实际读出的字节数
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_read(RingBuffer<N> *rb, void *data, uint16_t count)
+{
+	uint8_t head = rb->rb_head;
+	uint8_t avail = (uint8_t)(rb->rb_tail - head);
+	uint8_t copy_sz = count < avail ? (uint8_t)count : avail;
+	uint8_t first_sz = N - (head & RingBuffer<N>::Mask);
+
+	if(first_sz > copy_sz)
+		first_sz = copy_sz;
+	memcpy(data, rb->rb_buff + (head & RingBuffer<N>::Mask), first_sz);
+	memcpy((uint8_t *)data + first_sz, rb->rb_buff, copy_sz - first_sz);
+	RB_BARRIER();
+	rb->rb_head = head + copy_sz;
+	return copy_sz;
+}
+
+/*******************************************************************************
+* Function Name  : rb_write
+* Description    : 写入 count 个字节，折回时分两次拷贝
+* Input          : data:数据； count:字节数
+* Output         : None
+* Return         : count:写入成功； 0:空间不足，整段放弃
+* Attention		   : count 等于剩余空间时可以写满
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_write(RingBuffer<N> *rb, const void *data, uint16_t count)
+{
+	uint8_t tail = rb->rb_tail;
+	uint8_t first_sz = N - (tail & RingBuffer<N>::Mask);
+
+	if(count > rb_can_write(rb))
+		return 0;
+
+	if(first_sz > count)
+		first_sz = (uint8_t)count;
+	memcpy(rb->rb_buff + (tail & RingBuffer<N>::Mask), data, first_sz);
+	memcpy(rb->rb_buff, (const uint8_t *)data + first_sz, count - first_sz);
+	RB_BARRIER();
+	rb->rb_tail = tail + (uint8_t)count;
+	return (uint8_t)count;
+}
+
+/*******************************************************************************
+* Function Name  : rb_read_span
+* Description    : 取出可以直接读取的连续一段，不移动读位置
+* Input          : None
+* Output         : data:该段的起始地址
+* Return         : 该段的字节数，0 表示缓冲区为空
+* Attention		   : 读完后用 rb_read_commit 提交，提交前写方不会覆盖该段
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_read_span(RingBuffer<N> *rb, const uint8_t **data)
+{
+	uint8_t head = rb->rb_head;
+	uint8_t avail = (uint8_t)(rb->rb_tail - head);
+	uint8_t first_sz = N - (head & RingBuffer<N>::Mask);
+
+	*data = rb->rb_buff + (head & RingBuffer<N>::Mask);
+	return avail < first_sz ? avail : first_sz;
+}
+
+template<uint8_t N>
+inline void rb_read_commit(RingBuffer<N> *rb, uint8_t count)
+{
+	RB_BARRIER();
+	rb->rb_head = (uint8_t)(rb->rb_head + count);
+}
+
+/*******************************************************************************
+* Function Name  : rb_write_span
+* Description    : 取出可以直接写入的连续一段，不移动写位置
+* Input          : None
+* Output         : data:该段的起始地址
+* Return         : 该段的字节数，0 表示缓冲区已满
+* Attention		   : 写完后用 rb_write_commit 提交，提交前读方看不到这些数据
+*******************************************************************************/
+template<uint8_t N>
+inline uint8_t rb_write_span(RingBuffer<N> *rb, uint8_t **data)
+{
+	uint8_t tail = rb->rb_tail;
+	uint8_t room = rb_can_write(rb);
+	uint8_t first_sz = N - (tail & RingBuffer<N>::Mask);
+
+	*data = rb->rb_buff + (tail & RingBuffer<N>::Mask);
+	return room < first_sz ? room : first_sz;
+}
+
+template<uint8_t N>
+inline void rb_write_commit(RingBuffer<N> *rb, uint8_t count)
+{
+	RB_BARRIER();
+	rb->rb_tail = (uint8_t)(rb->rb_tail + count);
+}
 
 #endif
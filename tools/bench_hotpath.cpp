@@ -0,0 +1,849 @@
+/********************************************************
+*
+* @file      [bench_hotpath.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     协议栈热点路径微基准(主机)
+*            按 Google Benchmark 的方式运行各内核：自动确定迭代次数，
+*            输出每次迭代的时间、CPU时间和吞吐量。内核包括 CheckSum、
+*            be16 读写(原 exchangeBytes)、rb_put/rb_get、rb_write/rb_read、
+*            rb_write_span/rb_read_span(与改为模板前的环形缓冲区对比)、
+*            Pro_GetFrame、MessageHandle 分发和 DevStatusUpgrade，
+*            P0结构与 sketch 相同(生成的 Kidsbox_P0.h)。
+*            每项重复 --repetitions 次(默认3)取最快的一次；--save 保存结果，
+*            --compare 与保存的结果比较，CPU时间增加超过 --threshold(默认20%)时返回1。
+*
+*            编译：
+*            g++ -O2 -Itools/host -Ilibraries/GizWits -IKidsBox_arduino/Kidsbox_gizwits \
+*                tools/bench_hotpath.cpp tools/host/GizUart_host.cpp libraries/GizWits/GizWits.cpp \
+*                libraries/GizWits/GizTrace.cpp \
+*                libraries/GizWits/GizLog.cpp -o bench_hotpath
+*            运行：./bench_hotpath [--filter STR] [--min-time MS] [--repetitions N]
+*                                 [--save FILE] [--compare FILE] [--threshold PCT]
+*
+*********************************************************/
+#include <GizWitsStack.h>
+#include <GizUart_host.h>
+#include <HostFrame.h>
+#include <Kidsbox_P0.h>
+#include <getopt.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#define BENCH_FRAMES		256		//预先生成的帧数，SN 各不相同，不会被当作重发
+
+SoftwareSerial mySerial(12, 13);
+uint8_t gaterSensorFlag;
+
+static const Pro_ReportAttrTypeDef BenchReportAttr[] =
+{
+	{ Kidsbox_LED_OnOff::Offset,   Kidsbox_LED_OnOff::Size,   Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_R::Offset,       Kidsbox_LED_R::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_G::Offset,       Kidsbox_LED_G::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_B::Offset,       Kidsbox_LED_B::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_Motor_Speed::Offset, Kidsbox_Motor_Speed::Size, Report_Urgent, 0, 0     },
+	{ Kidsbox_Infrared::Offset,    Kidsbox_Infrared::Size,    Report_Urgent, 0, 0     },
+	{ Kidsbox_Temperature::Offset, Kidsbox_Temperature::Size, Report_Normal, 1, 5000  },
+	{ Kidsbox_Humidity::Offset,    Kidsbox_Humidity::Size,    Report_Normal, 3, 30000 },
+	{ Kidsbox_Alert_1::Offset,     Kidsbox_Alert_1::Size,     Report_Urgent, 0, 0     },
+	{ Kidsbox_Fault_LED::Offset,   Kidsbox_Fault_LED::Size,   Report_Urgent, 0, 0     },
+};
+
+static GizWits<Kidsbox_ReadTypeDef, Kidsbox_WriteTypeDef, GizUart_Transport> Bench;
+static Kidsbox_ReadTypeDef Bench_Status;
+static uint8_t Bench_LastSN;		//设备最近发出的帧的SN，用于回复ACK
+
+/*****************************************************
+* 计时
+******************************************************/
+typedef struct
+{
+	uint64_t	Iterations;
+	uint64_t	Items;			//内核处理的帧数，用于 items_per_second
+	uint64_t	Bytes;			//内核处理的字节数，用于 bytes_per_second
+	double		WallStart;
+	double		CpuStart;
+}BenchStateTypeDef;
+
+typedef void (*BenchFunc)(BenchStateTypeDef *s, int Arg);
+
+typedef struct
+{
+	const char	*Name;
+	BenchFunc	Func;
+	int			Arg;			//小于0时不带参数
+}BenchCaseTypeDef;
+
+static double Bench_Clock(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//准备工作完成后调用，之前的时间不计入
+static void Bench_ResetTimer(BenchStateTypeDef *s)
+{
+	s->WallStart = Bench_Clock(CLOCK_MONOTONIC);
+	s->CpuStart = Bench_Clock(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+//阻止编译器把结果当作无用而删除计算
+template<typename T>
+static inline void Bench_Keep(const T &Value)
+{
+	__asm__ __volatile__("" : : "r,m"(Value) : "memory");
+}
+
+static void Bench_Sink(const uint8_t *Buf, uint16_t Len, void *arg)
+{
+	uint16_t i;
+
+	//取出设备发出帧的SN，帧头之前的转义不影响前6字节
+	if(Len >= 6 && Buf[0] == 0xFF && Buf[1] == 0xFF)
+	{
+		Bench_LastSN = Buf[5];
+	}
+	for(i = 0; i < Len; i++)
+	{
+		Bench_Keep(Buf[i]);
+	}
+}
+
+static void Bench_Reset(void)
+{
+	rb_new(&u_ring_buff);
+	//每个内核从同样的初始状态开始，统计计数也清零
+	memset((void *)&Bench, 0, sizeof(Bench));
+	new (&Bench) GizWits<Kidsbox_ReadTypeDef, Kidsbox_WriteTypeDef, GizUart_Transport>();
+	Bench.Init();
+	Bench.SetReportAttr(BenchReportAttr, sizeof(BenchReportAttr) / sizeof(BenchReportAttr[0]));
+	memset(&Bench_Status, 0, sizeof(Bench_Status));
+	Bench_Status.Motor_Speed = 5;
+	Bench.DevStatusUpgrade(Bench_Status, 10 * 60 * 1000, 1, 0);
+	GizUart_Poll();
+}
+
+/*****************************************************
+* 输入帧
+******************************************************/
+typedef struct
+{
+	uint8_t		Wire[HostFrame_Max * 2];
+	uint16_t	Len;
+}BenchWireTypeDef;
+
+static uint32_t rnd_state = 12345;
+static uint32_t rnd(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8;
+}
+
+static std::vector<BenchWireTypeDef> Bench_Make(uint8_t Cmd, uint8_t Action)
+{
+	std::vector<BenchWireTypeDef> out(BENCH_FRAMES);
+	uint8_t raw[HostFrame_Max];
+	uint8_t data[1 + sizeof(Kidsbox_WriteTypeDef)];
+	uint16_t len;
+	uint16_t i, k;
+
+	for(i = 0; i < BENCH_FRAMES; i++)
+	{
+		len = 0;
+		if(Action != 0)
+		{
+			data[len++] = Action;
+		}
+		if(Action == P0_W2D_Control_Devce_Action)
+		{
+			//全部可写数据点，数据中约五分之一为0xFF
+			data[len++] = 0x3F;
+			for(k = 1; k < sizeof(Kidsbox_WriteTypeDef); k++)
+			{
+				data[len++] = (rnd() % 5 == 0) ? 0xFF : (uint8_t)rnd();
+			}
+		}
+		len = HostFrame_Build(raw, Cmd, (uint8_t)i, data, len);
+		out[i].Len = HostFrame_Escape(out[i].Wire, raw, len);
+	}
+	return out;
+}
+
+/*****************************************************
+* 内核
+******************************************************/
+static void BM_CheckSum(BenchStateTypeDef *s, int Arg)
+{
+	std::vector<uint8_t> buf(Arg);
+	uint64_t n;
+	uint16_t i;
+
+	for(i = 0; i < Arg; i++)
+	{
+		buf[i] = (uint8_t)rnd();
+	}
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		Bench_Keep(buf[0]);
+		Bench_Keep(CheckSum(buf.data(), Arg));
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+//帧中的16位字段：写入并读回，原来由 exchangeBytes 转换
+static void BM_be16(BenchStateTypeDef *s, int Arg)
+{
+	be16<uint16_t> field[8];
+	uint16_t sum = 0;
+	uint64_t n;
+	uint8_t i;
+
+	(void)Arg;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		for(i = 0; i < 8; i++)
+		{
+			field[i] = (uint16_t)(n + i);
+		}
+		Bench_Keep(field);
+		for(i = 0; i < 8; i++)
+		{
+			sum += field[i];
+		}
+	}
+	Bench_Keep(sum);
+	s->Bytes = s->Iterations * sizeof(field);
+}
+
+/*****************************************************
+* 改为 RingBuffer<N> 模板之前的实现，原样保留作对比：
+* 容量固定为128，计数用 size_t，rb_read/rb_write 不内联
+******************************************************/
+#define LEGACY_CAPACITY		128
+#define LEGACY_MASK			(LEGACY_CAPACITY - 1)
+
+typedef struct {
+    volatile uint8_t rb_head;
+    volatile uint8_t rb_tail;
+    uint8_t rb_buff[LEGACY_CAPACITY];
+}Legacy_RingBuffer;
+
+static inline uint8_t legacy_put(Legacy_RingBuffer *rb, uint8_t value)
+{
+    uint8_t tail = rb->rb_tail;
+
+    if((uint8_t)(tail - rb->rb_head) >= LEGACY_CAPACITY)
+        return 0;
+    rb->rb_buff[tail & LEGACY_MASK] = value;
+    RB_BARRIER();
+    rb->rb_tail = tail + 1;
+    return 1;
+}
+
+static inline uint8_t legacy_get(Legacy_RingBuffer *rb, uint8_t *value)
+{
+    uint8_t head = rb->rb_head;
+
+    if(head == rb->rb_tail)
+        return 0;
+    *value = rb->rb_buff[head & LEGACY_MASK];
+    RB_BARRIER();
+    rb->rb_head = head + 1;
+    return 1;
+}
+
+static size_t legacy_can_read(Legacy_RingBuffer *rb)
+{
+    return (uint8_t)(rb->rb_tail - rb->rb_head);
+}
+
+static size_t legacy_can_write(Legacy_RingBuffer *rb)
+{
+    return LEGACY_CAPACITY - legacy_can_read(rb);
+}
+
+__attribute__((noinline)) static size_t legacy_read(Legacy_RingBuffer *rb, void *data, size_t count)
+{
+    uint8_t head = rb->rb_head;
+    size_t copy_sz = std::min(count, legacy_can_read(rb));
+    size_t first_sz = LEGACY_CAPACITY - (head & LEGACY_MASK);
+
+    if(first_sz > copy_sz)
+        first_sz = copy_sz;
+    memcpy(data, rb->rb_buff + (head & LEGACY_MASK), first_sz);
+    memcpy((uint8_t *)data + first_sz, rb->rb_buff, copy_sz - first_sz);
+    RB_BARRIER();
+    rb->rb_head = head + copy_sz;
+    return copy_sz;
+}
+
+__attribute__((noinline)) static size_t legacy_write(Legacy_RingBuffer *rb, const void *data, size_t count)
+{
+    uint8_t tail = rb->rb_tail;
+    size_t first_sz = LEGACY_CAPACITY - (tail & LEGACY_MASK);
+
+    if (count > legacy_can_write(rb))
+        return 0;
+
+    if(first_sz > count)
+        first_sz = count;
+    memcpy(rb->rb_buff + (tail & LEGACY_MASK), data, first_sz);
+    memcpy(rb->rb_buff, (const uint8_t *)data + first_sz, count - first_sz);
+    RB_BARRIER();
+    rb->rb_tail = tail + count;
+    return count;
+}
+
+//接收中断写入、主循环读出：逐字节
+static void BM_rb_put_get(BenchStateTypeDef *s, int Arg)
+{
+	RingBuffer<GIZ_RX_RING_SIZE> rb;
+	uint8_t value = 0;
+	uint64_t n;
+	int i;
+
+	rb_new(&rb);
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		for(i = 0; i < Arg; i++)
+		{
+			rb_put(&rb, (uint8_t)i);
+		}
+		for(i = 0; i < Arg; i++)
+		{
+			rb_get(&rb, &value);
+		}
+		Bench_Keep(value);
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+static void BM_legacy_put_get(BenchStateTypeDef *s, int Arg)
+{
+	Legacy_RingBuffer rb;
+	uint8_t value = 0;
+	uint64_t n;
+	int i;
+
+	rb.rb_head = rb.rb_tail = 0;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		for(i = 0; i < Arg; i++)
+		{
+			legacy_put(&rb, (uint8_t)i);
+		}
+		for(i = 0; i < Arg; i++)
+		{
+			legacy_get(&rb, &value);
+		}
+		Bench_Keep(value);
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+//Arg 等于容量时整段写满，读写位置不变，每次都跨过缓冲区末尾
+static void BM_rb_write_read(BenchStateTypeDef *s, int Arg)
+{
+	RingBuffer<GIZ_TX_RING_SIZE> rb;
+	std::vector<uint8_t> in(Arg), out(Arg);
+	uint64_t n;
+
+	rb_new(&rb);
+	//从中间开始，一部分读写跨过缓冲区末尾
+	rb.rb_head = rb.rb_tail = rb_capacity(&rb) / 2 + 3;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		Bench_Keep(rb_write(&rb, in.data(), Arg));
+		Bench_Keep(rb_read(&rb, out.data(), Arg));
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+static void BM_legacy_write_read(BenchStateTypeDef *s, int Arg)
+{
+	Legacy_RingBuffer rb;
+	std::vector<uint8_t> in(Arg), out(Arg);
+	uint64_t n;
+
+	rb.rb_head = rb.rb_tail = LEGACY_CAPACITY / 2 + 3;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		Bench_Keep(legacy_write(&rb, in.data(), Arg));
+		Bench_Keep(legacy_read(&rb, out.data(), Arg));
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+//写方直接在缓冲区中生成数据，读方直接在缓冲区中求和，不经过中间缓冲
+static void BM_rb_span(BenchStateTypeDef *s, int Arg)
+{
+	RingBuffer<GIZ_TX_RING_SIZE> rb;
+	const uint8_t *rp;
+	uint8_t *wp;
+	uint8_t len;
+	uint8_t sum = 0;
+	uint64_t n;
+	int left;
+	int i;
+
+	rb_new(&rb);
+	rb.rb_head = rb.rb_tail = rb_capacity(&rb) / 2 + 3;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		for(left = Arg; left > 0 && (len = rb_write_span(&rb, &wp)) != 0; left -= len)
+		{
+			if(len > left)
+			{
+				len = (uint8_t)left;
+			}
+			for(i = 0; i < len; i++)
+			{
+				wp[i] = (uint8_t)i;
+			}
+			rb_write_commit(&rb, len);
+		}
+		while((len = rb_read_span(&rb, &rp)) != 0)
+		{
+			for(i = 0; i < len; i++)
+			{
+				sum += rp[i];
+			}
+			rb_read_commit(&rb, len);
+		}
+		Bench_Keep(sum);
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+//同样的生成和求和，经中间缓冲用 rb_write/rb_read 拷贝
+static void BM_rb_span_copy(BenchStateTypeDef *s, int Arg)
+{
+	RingBuffer<GIZ_TX_RING_SIZE> rb;
+	std::vector<uint8_t> in(Arg), out(Arg);
+	uint8_t sum = 0;
+	uint64_t n;
+	int i;
+
+	rb_new(&rb);
+	rb.rb_head = rb.rb_tail = rb_capacity(&rb) / 2 + 3;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		for(i = 0; i < Arg; i++)
+		{
+			in[i] = (uint8_t)i;
+		}
+		rb_write(&rb, in.data(), Arg);
+		rb_read(&rb, out.data(), Arg);
+		for(i = 0; i < Arg; i++)
+		{
+			sum += out[i];
+		}
+		Bench_Keep(sum);
+	}
+	s->Bytes = s->Iterations * Arg;
+}
+
+//模组发来的字节(经主机上的接收中断)到完整一帧
+static void Bench_GetFrame(BenchStateTypeDef *s, uint8_t Cmd, uint8_t Action)
+{
+	std::vector<BenchWireTypeDef> frames = Bench_Make(Cmd, Action);
+	uint64_t n;
+
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		const BenchWireTypeDef &f = frames[n % BENCH_FRAMES];
+
+		HostUart_Rx(f.Wire, f.Len);
+		Bench_Keep(Bench.Pro_GetFrame());
+		Bench.packageFlag = 0;
+		s->Bytes += f.Len;
+	}
+	s->Items = s->Iterations;
+}
+
+static void BM_Pro_GetFrame_Heartbeat(BenchStateTypeDef *s, int Arg)
+{
+	(void)Arg;
+	Bench_GetFrame(s, Pro_W2D_Heartbeat_Cmd, 0);
+}
+
+static void BM_Pro_GetFrame_Control(BenchStateTypeDef *s, int Arg)
+{
+	(void)Arg;
+	Bench_GetFrame(s, Pro_W2D_P0_Cmd, P0_W2D_Control_Devce_Action);
+}
+
+//收帧、分发、回复及控制命令入队出队，每次迭代处理一帧
+static void Bench_MessageHandle(BenchStateTypeDef *s, uint8_t Cmd, uint8_t Action)
+{
+	std::vector<BenchWireTypeDef> frames = Bench_Make(Cmd, Action);
+	Kidsbox_WriteTypeDef control;
+	uint64_t n;
+
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		const BenchWireTypeDef &f = frames[n % BENCH_FRAMES];
+
+		HostUart_Rx(f.Wire, f.Len);
+		Bench_Keep(Bench.MessageHandle());
+		while(Bench.ControlGet(control))
+		{
+			Bench_Keep(control);
+		}
+		s->Bytes += f.Len;
+	}
+	s->Items = s->Iterations;
+}
+
+static void BM_MessageHandle_Heartbeat(BenchStateTypeDef *s, int Arg)
+{
+	(void)Arg;
+	Bench_MessageHandle(s, Pro_W2D_Heartbeat_Cmd, 0);
+}
+
+static void BM_MessageHandle_Control(BenchStateTypeDef *s, int Arg)
+{
+	(void)Arg;
+	Bench_MessageHandle(s, Pro_W2D_P0_Cmd, P0_W2D_Control_Devce_Action);
+}
+
+static void BM_MessageHandle_Read(BenchStateTypeDef *s, int Arg)
+{
+	(void)Arg;
+	Bench_MessageHandle(s, Pro_W2D_P0_Cmd, P0_W2D_ReadDevStatus_Action);
+}
+
+//状态未变化：只扫描属性表
+static void BM_DevStatusUpgrade_Idle(BenchStateTypeDef *s, int Arg)
+{
+	uint64_t n;
+
+	(void)Arg;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		Bench.DevStatusUpgrade(Bench_Status, 10 * 60 * 1000, 0, 0);
+	}
+	s->Items = s->Iterations;
+}
+
+//每次一个紧急属性变化：组帧发出，模组回复ACK后由 MessageHandle 释放窗口
+static void BM_DevStatusUpgrade_Report(BenchStateTypeDef *s, int Arg)
+{
+	uint8_t raw[HostFrame_Max];
+	uint8_t wire[HostFrame_Max * 2];
+	uint16_t len;
+	uint64_t n;
+
+	(void)Arg;
+	Bench_ResetTimer(s);
+	for(n = 0; n < s->Iterations; n++)
+	{
+		Bench_Status.LED_R = (uint8_t)n;
+		Bench.DevStatusUpgrade(Bench_Status, 10 * 60 * 1000, 0, 0);
+		GizUart_Poll();
+		len = HostFrame_Build(raw, Pro_W2D_P0_Ack_Cmd, Bench_LastSN, NULL, 0);
+		len = HostFrame_Escape(wire, raw, len);
+		HostUart_Rx(wire, len);
+		Bench.MessageHandle();
+	}
+	s->Items = s->Iterations;
+}
+
+static const BenchCaseTypeDef Bench_Case[] =
+{
+	{ "BM_CheckSum",                BM_CheckSum,                16  },
+	{ "BM_CheckSum",                BM_CheckSum,                64  },
+	{ "BM_CheckSum",                BM_CheckSum,                255 },
+	{ "BM_be16",                    BM_be16,                    -1  },
+	{ "BM_rb_put_get",              BM_rb_put_get,              16  },
+	{ "BM_rb_put_get",              BM_rb_put_get,              64  },
+	{ "BM_legacy_put_get",          BM_legacy_put_get,          64  },
+	{ "BM_rb_write_read",           BM_rb_write_read,           16  },
+	{ "BM_rb_write_read",           BM_rb_write_read,           64  },
+	{ "BM_rb_write_read",           BM_rb_write_read,           120 },
+	{ "BM_rb_write_read",           BM_rb_write_read,           128 },
+	{ "BM_legacy_write_read",       BM_legacy_write_read,       16  },
+	{ "BM_legacy_write_read",       BM_legacy_write_read,       64  },
+	{ "BM_legacy_write_read",       BM_legacy_write_read,       120 },
+	{ "BM_legacy_write_read",       BM_legacy_write_read,       128 },
+	{ "BM_rb_span",                 BM_rb_span,                 64  },
+	{ "BM_rb_span",                 BM_rb_span,                 120 },
+	{ "BM_rb_span_copy",            BM_rb_span_copy,            64  },
+	{ "BM_rb_span_copy",            BM_rb_span_copy,            120 },
+	{ "BM_Pro_GetFrame/heartbeat",  BM_Pro_GetFrame_Heartbeat,  -1  },
+	{ "BM_Pro_GetFrame/control",    BM_Pro_GetFrame_Control,    -1  },
+	{ "BM_MessageHandle/heartbeat", BM_MessageHandle_Heartbeat, -1  },
+	{ "BM_MessageHandle/control",   BM_MessageHandle_Control,   -1  },
+	{ "BM_MessageHandle/read",      BM_MessageHandle_Read,      -1  },
+	{ "BM_DevStatusUpgrade/idle",   BM_DevStatusUpgrade_Idle,   -1  },
+	{ "BM_DevStatusUpgrade/report", BM_DevStatusUpgrade_Report, -1  },
+};
+
+/*****************************************************
+* 运行
+******************************************************/
+typedef struct
+{
+	std::string	Name;
+	double		WallNs;			//每次迭代
+	double		CpuNs;
+	uint64_t	Iterations;
+	double		ItemRate;		//每秒
+	double		ByteRate;
+	const char	*Error;			//内核运行结果不对时的说明
+}BenchResultTypeDef;
+
+//输入帧都合法且SN不重复，协议栈报告错误说明内核没有走预期的路径。
+//不检查 Drop_Num：校验和为0xFF的帧之后的转义字节0x55由解析器计入丢弃
+static const char *Bench_Error(void)
+{
+	const Pro_RxStatTypeDef *rx = Bench.GetRxStat();
+	const Pro_AckStatTypeDef *ack = Bench.GetAckStat();
+
+	if(rx->SumErr_Num || rx->LenErr_Num || rx->Overflow_Num)
+	{
+		return "frames rejected by the parser";
+	}
+	if(rx->Busy_Num || rx->Dup_Num)
+	{
+		return "control frames not executed";
+	}
+	if(ack->Resend_Num || ack->GiveUp_Num)
+	{
+		return "reports not ACKed";
+	}
+	return NULL;
+}
+
+static void Bench_RunOnce(const BenchCaseTypeDef *c, uint64_t iterations, BenchStateTypeDef *s, double *wall, double *cpu)
+{
+	memset(s, 0, sizeof(*s));
+	s->Iterations = iterations;
+	Bench_Reset();
+	Bench_ResetTimer(s);
+	c->Func(s, c->Arg);
+	*wall = Bench_Clock(CLOCK_MONOTONIC) - s->WallStart;
+	*cpu = Bench_Clock(CLOCK_PROCESS_CPUTIME_ID) - s->CpuStart;
+}
+
+//与 Google Benchmark 相同：迭代次数逐步放大，直到一次运行达到最短时间；
+//之后再重复 repeat - 1 次，取CPU时间最短的一次，减少调度和频率变化的影响
+static BenchResultTypeDef Bench_Run(const BenchCaseTypeDef *c, double min_ns, int repeat)
+{
+	BenchResultTypeDef r;
+	BenchStateTypeDef s, t;
+	uint64_t iterations = 1;
+	double wall, cpu, scale;
+	double wall2, cpu2;
+	const char *error;
+
+	for(;;)
+	{
+		Bench_RunOnce(c, iterations, &s, &wall, &cpu);
+		if(wall >= min_ns || iterations >= 1000000000ULL)
+		{
+			break;
+		}
+		scale = (wall > min_ns / 100) ? min_ns * 1.4 / wall : 10;
+		iterations = (uint64_t)(iterations * std::min(std::max(scale, 1.5), 10.0)) + 1;
+	}
+	error = Bench_Error();
+	while(--repeat > 0)
+	{
+		Bench_RunOnce(c, iterations, &t, &wall2, &cpu2);
+		if(error == NULL)
+		{
+			error = Bench_Error();
+		}
+		if(cpu2 < cpu)
+		{
+			s = t;
+			wall = wall2;
+			cpu = cpu2;
+		}
+	}
+	r.Name = c->Name;
+	if(c->Arg >= 0)
+	{
+		r.Name += "/" + std::to_string(c->Arg);
+	}
+	r.WallNs = wall / iterations;
+	r.CpuNs = cpu / iterations;
+	r.Iterations = iterations;
+	r.ItemRate = s.Items * 1e9 / cpu;
+	r.ByteRate = s.Bytes * 1e9 / cpu;
+	r.Error = error;
+	return r;
+}
+
+static std::string Bench_Human(double v)
+{
+	static const char *unit[] = { "", "k", "M", "G", "T" };
+	char buf[32];
+	int u = 0;
+
+	while(v >= 1000 && u < 4)
+	{
+		v /= 1000;
+		u++;
+	}
+	snprintf(buf, sizeof(buf), "%.4g%s", v, unit[u]);
+	return buf;
+}
+
+static std::map<std::string, double> Bench_Load(const char *path)
+{
+	std::map<std::string, double> out;
+	char name[128];
+	double ns;
+	FILE *f = fopen(path, "r");
+
+	if(f == NULL)
+	{
+		perror(path);
+		exit(2);
+	}
+	while(fscanf(f, "%127s %lf", name, &ns) == 2)
+	{
+		out[name] = ns;
+	}
+	fclose(f);
+	return out;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] =
+	{
+		{ "filter",    required_argument, NULL, 'f' },
+		{ "min-time",  required_argument, NULL, 't' },
+		{ "save",      required_argument, NULL, 's' },
+		{ "compare",   required_argument, NULL, 'c' },
+		{ "threshold", required_argument, NULL, 'p' },
+		{ "repetitions", required_argument, NULL, 'r' },
+		{ NULL, 0, NULL, 0 }
+	};
+	std::map<std::string, double> base;
+	std::vector<BenchResultTypeDef> results;
+	const char *filter = NULL;
+	const char *save = NULL;
+	const char *compare = NULL;
+	double min_ms = 200;
+	double threshold = 20;
+	int repeat = 3;
+	uint8_t slower = 0;
+	size_t i;
+	int c;
+
+	while((c = getopt_long(argc, argv, "", opts, NULL)) != -1)
+	{
+		switch(c)
+		{
+			case 'f': filter = optarg; break;
+			case 't': min_ms = atof(optarg); break;
+			case 's': save = optarg; break;
+			case 'c': compare = optarg; break;
+			case 'p': threshold = atof(optarg); break;
+			case 'r': repeat = std::max(atoi(optarg), 1); break;
+			default:
+				fprintf(stderr, "usage: %s [--filter STR] [--min-time MS] [--repetitions N] [--save FILE] [--compare FILE] [--threshold PCT]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(compare != NULL)
+	{
+		base = Bench_Load(compare);
+	}
+
+	HostUart_SetSink(Bench_Sink, NULL);
+	printf("%-32s %13s %15s %12s %s\n", "Benchmark", "Time", "CPU", "Iterations", compare ? "Change  UserCounters..." : "UserCounters...");
+	printf("%s\n", std::string(compare ? 100 : 92, '-').c_str());
+	for(i = 0; i < sizeof(Bench_Case) / sizeof(Bench_Case[0]); i++)
+	{
+		BenchResultTypeDef r;
+		std::string counters;
+
+		if(filter != NULL && strstr(Bench_Case[i].Name, filter) == NULL)
+		{
+			continue;
+		}
+		r = Bench_Run(&Bench_Case[i], min_ms * 1e6, repeat);
+		results.push_back(r);
+
+		if(r.Error != NULL)
+		{
+			counters = std::string(" ERROR: ") + r.Error;
+		}
+		else if(r.ByteRate > 0)
+		{
+			counters += " bytes_per_second=" + Bench_Human(r.ByteRate) + "/s";
+		}
+		if(r.Error == NULL && r.ItemRate > 0)
+		{
+			counters += " items_per_second=" + Bench_Human(r.ItemRate) + "/s";
+		}
+		printf("%-32s %10.1f ns %12.1f ns %12llu", r.Name.c_str(), r.WallNs, r.CpuNs, (unsigned long long)r.Iterations);
+		if(compare != NULL)
+		{
+			if(base.count(r.Name))
+			{
+				double change = (r.CpuNs - base[r.Name]) * 100 / base[r.Name];
+
+				printf(" %+6.1f%%%s", change, change > threshold ? "!" : " ");
+				slower |= (change > threshold);
+			}
+			else
+			{
+				printf(" %8s", "new");
+			}
+		}
+		printf("%s\n", counters.c_str());
+		fflush(stdout);
+	}
+
+	if(save != NULL)
+	{
+		FILE *f = fopen(save, "w");
+
+		if(f == NULL)
+		{
+			perror(save);
+			return 2;
+		}
+		for(i = 0; i < results.size(); i++)
+		{
+			fprintf(f, "%s %.3f\n", results[i].Name.c_str(), results[i].CpuNs);
+		}
+		fclose(f);
+	}
+	if(slower)
+	{
+		printf("CPU time per iteration more than %.0f%% above %s (marked !)\n", threshold, compare);
+	}
+	for(i = 0; i < results.size(); i++)
+	{
+		if(results[i].Error != NULL)
+		{
+			return 2;
+		}
+	}
+	return slower;
+}
@@ -0,0 +1,314 @@
+/********************************************************
+*
+* @file      [bench_resync.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     帧重同步基准测试(主机)
+*            向 Pro_GetFrame 灌入各种损坏的串口字节流，统计解析器
+*            重新锁定到正确帧所浪费的字节、损失的正确帧以及所需时间。
+*
+*            编译：
+*            g++ -O2 -Itools/host -Ilibraries/GizWits tools/bench_resync.cpp \
+*                tools/host/GizUart_host.cpp libraries/GizWits/GizWits.cpp \
+*                libraries/GizWits/GizTrace.cpp \
+*                libraries/GizWits/GizLog.cpp -o bench_resync
+*            运行：./bench_resync [每种损坏的次数，默认 10000]
+*
+*********************************************************/
+#include <GizWitsStack.h>
+#include <GizUart_host.h>
+#include <HostFrame.h>
+#include <chrono>
+
+#define BENCH_FOLLOW		3		//每个损坏帧之后跟随的正确帧数
+#define BENCH_BYTE_MS		1		//9600波特率下约每毫秒一个字节
+
+SoftwareSerial mySerial(12, 13);
+uint8_t gaterSensorFlag;
+
+typedef struct { uint8_t Byte[16]; } BenchReadTypeDef;
+typedef struct { uint8_t Byte[32]; } BenchWriteTypeDef;	//决定解析器可接收的最大帧长度
+
+static GizWits<BenchReadTypeDef, BenchWriteTypeDef, GizUart_Transport> Bench;
+
+typedef enum
+{
+	Corrupt_None,			//不损坏，作为对照
+	Corrupt_DropHead,		//丢失帧头的一个0xFF
+	Corrupt_DropByte,		//丢失帧中任意一个字节
+	Corrupt_FlipByte,		//帧中任意一个字节出错
+	Corrupt_Garbage,		//帧前插入一段随机字节
+	Corrupt_TruncGap,		//帧发送一半后停止，间隔后发下一帧
+	Corrupt_TruncFF,		//帧在数据0xFF之后中断，间隔后发下一帧
+	Corrupt_Num,
+}CorruptTypeDef;
+
+static const char *Corrupt_Name[Corrupt_Num] =
+{
+	"none", "drop-head", "drop-byte", "flip-byte", "garbage", "trunc+gap", "trunc-after-FF",
+};
+
+typedef struct
+{
+	uint8_t		Raw[HostFrame_Max];
+	uint16_t	RawLen;
+	uint8_t		Wire[HostFrame_Max * 2];
+	uint16_t	WireLen;
+}BenchFrameTypeDef;
+
+static uint32_t rnd_state = 12345;
+static uint32_t rnd(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8;
+}
+
+//随机生成心跳或P0控制帧，控制数据中故意包含0xFF
+static void Bench_MakeFrame(BenchFrameTypeDef *f, uint8_t sn, uint8_t force_ff)
+{
+	uint8_t data[16];
+	uint8_t len;
+	uint8_t i;
+
+	if(force_ff == 0 && (rnd() & 3) == 0)
+	{
+		f->RawLen = HostFrame_Build(f->Raw, Pro_W2D_Heartbeat_Cmd, sn, NULL, 0);
+	}
+	else
+	{
+		len = 2 + rnd() % 12;
+		data[0] = P0_W2D_Control_Devce_Action;
+		for(i = 1; i < len; i++)
+		{
+			data[i] = (rnd() % 5 == 0) ? 0xFF : (uint8_t)rnd();
+		}
+		if(force_ff)
+		{
+			data[len / 2] = 0xFF;
+		}
+		f->RawLen = HostFrame_Build(f->Raw, Pro_W2D_P0_Cmd, sn, data, len);
+	}
+	f->WireLen = HostFrame_Escape(f->Wire, f->Raw, f->RawLen);
+}
+
+//按损坏方式生成字节流，返回长度；gap_at 为需要插入静默间隔的位置
+static uint16_t Bench_Corrupt(CorruptTypeDef type, const BenchFrameTypeDef *f, uint8_t *out, int *gap_at)
+{
+	uint16_t n = f->WireLen;
+	uint16_t pos;
+	uint16_t i;
+
+	*gap_at = -1;
+	memcpy(out, f->Wire, n);
+	switch(type)
+	{
+		case Corrupt_DropHead:
+			memmove(out, out + 1, --n);
+			break;
+		case Corrupt_DropByte:
+			pos = rnd() % n;
+			memmove(out + pos, out + pos + 1, n - pos - 1);
+			n--;
+			break;
+		case Corrupt_FlipByte:
+			pos = rnd() % n;
+			out[pos] ^= (uint8_t)(1 + rnd() % 255);
+			break;
+		case Corrupt_Garbage:
+			pos = 1 + rnd() % 32;
+			memmove(out + pos, out, n);
+			for(i = 0; i < pos; i++)
+			{
+				out[i] = (rnd() % 4 == 0) ? 0xFF : (uint8_t)rnd();
+			}
+			n += pos;
+			break;
+		case Corrupt_TruncGap:
+			n = 4 + rnd() % (n - 5);
+			*gap_at = n;
+			break;
+		case Corrupt_TruncFF:
+			for(pos = 8; pos < n; pos++)
+			{
+				if(out[pos] == 0xFF)
+				{
+					break;
+				}
+			}
+			n = pos + 1;
+			*gap_at = n;
+			break;
+		default:
+			break;
+	}
+	return n;
+}
+
+typedef struct
+{
+	uint32_t	Trials;
+	uint32_t	Locked;			//重新锁定到正确帧的次数
+	uint64_t	WasteBytes;		//锁定前浪费的字节
+	uint32_t	WasteMax;
+	uint64_t	LostFrames;		//损坏之后的正确帧中未能收到的帧
+	uint64_t	RelockMs;		//从损坏开始到收到第一个正确帧的模拟时间
+	uint32_t	RelockMsMax;
+	uint64_t	Bytes;
+	double		ParseNs;
+}BenchResultTypeDef;
+
+//逐字节送入并解析，每收到一帧调用 on_frame，返回收到的帧数
+static uint8_t Bench_Feed(const uint8_t *buf, uint16_t len, BenchResultTypeDef *r, uint32_t *fed, uint8_t (*on_frame)(void *), void *arg)
+{
+	uint8_t frames = 0;
+	uint16_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		HostUart_Rx(&buf[i], 1);
+		SystemTimeCount += BENCH_BYTE_MS;
+		(*fed)++;
+		auto t0 = std::chrono::steady_clock::now();
+		uint8_t got = (Bench.Pro_GetFrame() == 0);
+		r->ParseNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+		if(got)
+		{
+			Bench.packageFlag = 0;
+			frames++;
+			if(on_frame(arg))
+			{
+				return frames;
+			}
+		}
+	}
+	return frames;
+}
+
+typedef struct
+{
+	const BenchFrameTypeDef *Expect;
+	uint8_t Match;
+}BenchMatchTypeDef;
+
+static uint8_t Bench_OnFrame(void *arg)
+{
+	BenchMatchTypeDef *m = (BenchMatchTypeDef *)arg;
+
+	if(Bench.UART_HandleStruct.Parse_SumOk && Bench.UART_HandleStruct.Message_Len == m->Expect->RawLen &&
+		memcmp(Bench.UART_HandleStruct.Message_Buf, m->Expect->Raw, m->Expect->RawLen) == 0)
+	{
+		m->Match = 1;
+	}
+	return 0;
+}
+
+static void Bench_Locked(BenchResultTypeDef *r, uint32_t waste, uint32_t ms)
+{
+	r->Locked++;
+	r->WasteBytes += waste;
+	r->RelockMs += ms;
+	if(waste > r->WasteMax) r->WasteMax = waste;
+	if(ms > r->RelockMsMax) r->RelockMsMax = ms;
+}
+
+static void Bench_Run(CorruptTypeDef type, uint32_t trials, BenchResultTypeDef *r)
+{
+	BenchFrameTypeDef bad, good[BENCH_FOLLOW];
+	BenchMatchTypeDef match;
+	uint8_t stream[HostFrame_Max * 4];
+	uint16_t n;
+	uint32_t fed;
+	uint32_t start_ms;
+	int gap_at;
+	uint8_t sn = 0;
+	uint8_t locked;
+	uint8_t k;
+
+	memset(r, 0, sizeof(*r));
+	for(r->Trials = 0; r->Trials < trials; r->Trials++)
+	{
+		Bench_MakeFrame(&bad, sn++, type == Corrupt_TruncFF);
+		for(k = 0; k < BENCH_FOLLOW; k++)
+		{
+			Bench_MakeFrame(&good[k], sn++, 0);
+		}
+
+		fed = 0;
+		start_ms = SystemTimeCount;
+		n = Bench_Corrupt(type, &bad, stream, &gap_at);
+		match.Expect = &bad;
+		match.Match = 0;
+		Bench_Feed(stream, n, r, &fed, Bench_OnFrame, &match);
+		if(gap_at >= 0)
+		{
+			//静默间隔：只推进时间，解析器在缓冲区取空后判断超时
+			SystemTimeCount += Frame_GapTime + 1;
+			Bench.Pro_GetFrame();
+		}
+		//损坏没有影响这一帧(或未损坏)时直接算作已锁定
+		locked = match.Match;
+		if(locked)
+		{
+			Bench_Locked(r, 0, SystemTimeCount - start_ms);
+		}
+
+		for(k = 0; k < BENCH_FOLLOW; k++)
+		{
+			uint32_t before = fed;
+
+			match.Expect = &good[k];
+			match.Match = 0;
+			Bench_Feed(good[k].Wire, good[k].WireLen, r, &fed, Bench_OnFrame, &match);
+			if(match.Match == 0)
+			{
+				r->LostFrames++;
+			}
+			else if(locked == 0)
+			{
+				locked = 1;
+				Bench_Locked(r, before, SystemTimeCount - start_ms);
+			}
+		}
+		r->Bytes += fed;
+
+		//两次试验之间的空闲，保证下一次从干净的状态开始
+		SystemTimeCount += Frame_GapTime + 1;
+		Bench.Pro_GetFrame();
+		Bench.packageFlag = 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t trials = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+	BenchResultTypeDef r;
+	Pro_RxStatTypeDef before, after;
+	int type;
+
+	Bench.Init();
+
+	printf("%-15s %7s %8s %10s %10s %10s %10s %10s %8s %8s %8s\n",
+		"corruption", "trials", "relock%", "waste avg", "waste max", "lost/trial",
+		"relock ms", "ms max", "resync", "timeout", "ns/byte");
+	for(type = 0; type < Corrupt_Num; type++)
+	{
+		before = *Bench.GetRxStat();
+		Bench_Run((CorruptTypeDef)type, trials, &r);
+		after = *Bench.GetRxStat();
+		printf("%-15s %7u %7.2f%% %10.2f %10u %10.3f %10.2f %10u %8u %8u %8.1f\n",
+			Corrupt_Name[type], r.Trials, 100.0 * r.Locked / r.Trials,
+			r.Locked ? (double)r.WasteBytes / r.Locked : 0.0, r.WasteMax,
+			(double)r.LostFrames / r.Trials,
+			r.Locked ? (double)r.RelockMs / r.Locked : 0.0, r.RelockMsMax,
+			(uint16_t)(after.Resync_Num - before.Resync_Num),
+			(uint16_t)(after.Timeout_Num - before.Timeout_Num),
+			r.Bytes ? r.ParseNs / r.Bytes : 0.0);
+	}
+
+	after = *Bench.GetRxStat();
+	printf("\nrx stat: frames %u sum-err %u len-err %u dropped %u overflow %u (16-bit counters wrap)\n",
+		after.Frame_Num, after.SumErr_Num, after.LenErr_Num, after.Drop_Num, after.Overflow_Num);
+	return 0;
+}
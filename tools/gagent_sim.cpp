@@ -0,0 +1,869 @@
+/********************************************************
+*
+* @file      [gagent_sim.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     GAgent WiFi模组模拟器(主机)
+*            模拟模组一侧的协议：请求设备信息、心跳、P0控制/读状态、
+*            通知WiFi状态，并对设备的主动上报、配置、复位回复ACK；
+*            可发送长于接收缓冲区的透传P0帧，设备分块接收后原样分块发回。
+*            默认通过 socketpair 与子进程中本机编译的 GizWits 协议栈通信；
+*            --tty 可改为连接一个串口或 pty(例如接真实设备)。
+*            可设置时延、丢帧、误码、逐字节发送间隔，结束时输出
+*            帧速率、ACK往返时间分位数、重发次数及丢帧率。
+*
+*            编译：
+*            g++ -O2 -Itools/host -Ilibraries/GizWits -IKidsBox_arduino/Kidsbox_gizwits tools/gagent_sim.cpp \
+*                tools/host/GizUart_host.cpp libraries/GizWits/GizWits.cpp \
+*                libraries/GizWits/GizTrace.cpp \
+*                libraries/GizWits/GizLog.cpp -o gagent_sim
+*            运行：./gagent_sim --duration 10000 --latency 30 --loss 5 --corrupt 1
+*
+*********************************************************/
+#include <GizWitsStack.h>
+#include <GizUart_host.h>
+#include <GizTrace.h>
+#include <HostFrame.h>
+#include <Kidsbox_P0.h>
+
+#include <algorithm>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+	uint32_t		Duration;		//运行时间(ms)
+	uint32_t		Latency;		//模组回复及发出请求前的固定时延(ms)
+	uint32_t		Jitter;			//附加的随机时延上限(ms)
+	double			Loss;			//每个方向的整帧丢失概率(%)
+	double			Corrupt;		//模组发出的帧中一个字节出错的概率(%)
+	uint32_t		Pace;			//逐字节发送间隔(us)，0为整帧写出
+	uint32_t		Heartbeat;		//心跳周期(ms)
+	uint32_t		Control;		//P0控制周期(ms)
+	uint32_t		Read;			//P0读状态周期(ms)
+	uint32_t		WifiStatus;		//WiFi状态通知周期(ms)
+	uint32_t		Timeout;		//请求无回复视为丢失的时间(ms)
+	uint32_t		Actuate;		//设备执行一条控制命令的时间(ms)
+	uint32_t		Seed;
+	const char		*Tty;
+	const char		*Trace;			//结束时把设备的收发记录写入此文件
+	uint8_t			Debug;			//设备的 mySerial 输出到 stderr
+	uint8_t			Block;			//执行控制命令时阻塞主循环(旧 sketch 的做法)
+	uint32_t		Retry;			//请求无回复时按此间隔用相同SN重发(ms)，0:不重发
+	uint32_t		OutageStart;	//模拟云端断开的开始时间(ms)
+	uint32_t		OutageLen;		//云端断开的时长(ms)，0:不断开
+	uint32_t		StreamLen;		//透传P0帧的数据长度，0:不发送
+	uint32_t		StreamPeriod;	//透传P0帧的发送周期(ms)
+}SimOptTypeDef;
+
+static SimOptTypeDef SimOpt =
+{
+	10000, 20, 10, 0.0, 0.0, 0, 1000, 700, 1500, 5000, 2000, 0, 1, NULL, NULL, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static uint32_t Sim_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t rnd_state;
+static uint32_t Sim_Rand(void)
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8;
+}
+
+static uint8_t Sim_Chance(double percent)
+{
+	return percent > 0 && (Sim_Rand() % 100000) < (uint32_t)(percent * 1000);
+}
+
+static void Sim_WriteAll(int fd, const uint8_t *buf, uint16_t len)
+{
+	ssize_t n;
+
+	while(len > 0)
+	{
+		n = write(fd, buf, len);
+		if(n < 0)
+		{
+			if(errno == EAGAIN || errno == EINTR)
+			{
+				usleep(100);
+				continue;
+			}
+			return;
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/*****************************************************
+* 设备一侧：与 Kidsbox_gizwits.ino 相同的 P0 结构(生成的 Kidsbox_P0.h)和上报属性，
+* 在子进程中跑本机编译的协议栈
+******************************************************/
+typedef Kidsbox_ReadTypeDef SimReadTypeDef;
+typedef Kidsbox_WriteTypeDef SimWriteTypeDef;
+
+static const Pro_ReportAttrTypeDef SimReportAttr[] =
+{
+	{ Kidsbox_LED_OnOff::Offset,   Kidsbox_LED_OnOff::Size,   Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_R::Offset,       Kidsbox_LED_R::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_G::Offset,       Kidsbox_LED_G::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_LED_B::Offset,       Kidsbox_LED_B::Size,       Report_Urgent, 0, 0     },
+	{ Kidsbox_Motor_Speed::Offset, Kidsbox_Motor_Speed::Size, Report_Urgent, 0, 0     },
+	{ Kidsbox_Infrared::Offset,    Kidsbox_Infrared::Size,    Report_Urgent, 0, 0     },
+	{ Kidsbox_Temperature::Offset, Kidsbox_Temperature::Size, Report_Normal, 1, 5000  },
+	{ Kidsbox_Humidity::Offset,    Kidsbox_Humidity::Size,    Report_Normal, 3, 30000 },
+	{ Kidsbox_Alert_1::Offset,     Kidsbox_Alert_1::Size,     Report_Urgent, 0, 0     },
+	{ Kidsbox_Fault_LED::Offset,   Kidsbox_Fault_LED::Size,   Report_Urgent, 0, 0     },
+};
+
+SoftwareSerial mySerial(12, 13);
+uint8_t gaterSensorFlag;
+
+static SimReadTypeDef Dev_Status;
+
+//控制命令直接写入状态，由生成的 Kidsbox_Control 按 Attr_Flags 调用
+struct SimControl
+{
+	static void LED_OnOff(uint8_t Value) { Pro_P0Set<Kidsbox_LED_OnOff>(Dev_Status, Value); }
+	static void LED_Color(uint8_t Value) { Pro_P0Set<Kidsbox_LED_Color>(Dev_Status, Value); }
+	static void LED_R(uint8_t Value) { Dev_Status.LED_R = Value; }
+	static void LED_G(uint8_t Value) { Dev_Status.LED_G = Value; }
+	static void LED_B(uint8_t Value) { Dev_Status.LED_B = Value; }
+	static void Motor_Speed(uint16_t Value) { Dev_Status.Motor_Speed = Value; }
+};
+static uint16_t Dev_StatusVersion = 0;
+
+//透传数据的内容：第一个字节为种子，之后每字节加7，其中会出现需转义的0xFF
+static inline uint8_t Sim_StreamByte(uint8_t seed, uint16_t offset)
+{
+	return (uint8_t)(seed + offset * 7);
+}
+
+//分块接收的透传帧：逐块核对内容，校验正确后由主循环原样发回
+static uint8_t Dev_StreamSeed;
+static uint8_t Dev_StreamGood;
+static uint16_t Dev_StreamLen;
+static uint16_t Dev_EchoLen = 0;
+static uint8_t Dev_EchoSeed;
+static uint32_t Dev_StreamOk = 0;
+static uint32_t Dev_StreamFail = 0;
+
+static void Dev_EchoGen(void *arg, uint16_t Offset, uint8_t *Buf, uint8_t Len)
+{
+	uint8_t i;
+
+	for(i = 0; i < Len; i++)
+	{
+		Buf[i] = Sim_StreamByte(Dev_EchoSeed, Offset + i);
+	}
+}
+
+//与 sketch 相同：读取设备状态时回复实时状态
+struct SimHandler : GizWits_NoHandler
+{
+	static uint8_t ReadStatus(const SimReadTypeDef *&Status, uint16_t &Version)
+	{
+		Status = &Dev_Status;
+		Version = Dev_StatusVersion;
+		return 1;
+	}
+
+	static uint8_t StreamBegin(uint8_t Action, uint16_t Len)
+	{
+		if(Action != P0_W2D_Transparent_Action)
+		{
+			return 0;
+		}
+		Dev_StreamGood = 1;
+		Dev_StreamLen = Len;
+		return 1;
+	}
+
+	static void StreamChunk(uint16_t Offset, const uint8_t *Buf, uint8_t Len)
+	{
+		uint8_t i;
+
+		if(Offset == 0)
+		{
+			Dev_StreamSeed = Buf[0];
+		}
+		for(i = 0; i < Len; i++)
+		{
+			if(Buf[i] != Sim_StreamByte(Dev_StreamSeed, Offset + i))
+			{
+				Dev_StreamGood = 0;
+			}
+		}
+	}
+
+	static void StreamEnd(uint8_t Ok)
+	{
+		if(Ok && Dev_StreamGood)
+		{
+			Dev_StreamOk++;
+			Dev_EchoSeed = Dev_StreamSeed;
+			Dev_EchoLen = Dev_StreamLen;
+		}
+		else
+		{
+			Dev_StreamFail++;
+		}
+	}
+};
+
+//与 sketch 相同的协议栈代码，传输由 GizUart_host.cpp 提供
+static GizWits<SimReadTypeDef, SimWriteTypeDef, GizUart_Transport, SimHandler> Dev;
+
+#if (GIZ_TRACE == 1)
+static FILE *dev_trace;
+static void Dev_TracePut(uint8_t value)
+{
+	fputc(value, dev_trace);
+}
+#endif
+
+static void Dev_Sink(const uint8_t *Buf, uint16_t Len, void *arg)
+{
+	Sim_WriteAll(*(int *)arg, Buf, Len);
+}
+
+static void Dev_Run(int fd)
+{
+	SimReadTypeDef &status = Dev_Status;
+	SimWriteTypeDef control;
+	uint8_t rx[256];
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	uint32_t start = Sim_Now();
+	uint32_t last_sensor = 0;
+	uint32_t executed = 0;
+	uint32_t echoed = 0;
+	const Pro_AckStatTypeDef *ack;
+	const Pro_RxStatTypeDef *rxs;
+	ssize_t n;
+	size_t room;
+
+	HostUart_SetSink(Dev_Sink, &fd);
+	HostPrint_Enable(SimOpt.Debug);
+	memset(&status, 0, sizeof(status));
+	status.Motor_Speed = 5;
+	status.Temperature = 25;
+	status.Humidity = 40;
+	Dev.Init();
+	Dev.SetReportAttr(SimReportAttr, sizeof(SimReportAttr) / sizeof(SimReportAttr[0]));
+
+	for(;;)
+	{
+		SystemTimeCount = Sim_Now() - start;
+		//与串口一样按接收缓冲区的空间取数，长帧留在 socket 中由协议栈边收边处理
+		room = std::min(sizeof(rx), (size_t)rb_can_write(&u_ring_buff));
+		if(room != 0 && poll(&pfd, 1, 1) > 0)
+		{
+			n = read(fd, rx, room);
+			if(n <= 0)
+			{
+				break;
+			}
+			HostUart_Rx(rx, n);
+		}
+
+		Dev.MessageHandle();
+
+		if(Dev_EchoLen != 0 && Dev.StreamSend(P0_D2W_Transparent_Action, Dev_EchoLen, Dev_EchoGen, NULL))
+		{
+			Dev_EchoLen = 0;
+			echoed++;
+		}
+
+		//控制命令已由协议栈回复ACK，与 sketch 一样每次循环都取出；
+		//不阻塞的执行在主循环之外进行，执行中收到的新命令直接改变执行目标(如灯带动画按新颜色重新开始)
+		if(Dev.ControlGet(control))
+		{
+			executed++;
+			Kidsbox_Control<SimControl>(control);
+			Dev_StatusVersion++;
+			if(SimOpt.Actuate && SimOpt.Block)
+			{
+				usleep(SimOpt.Actuate * 1000);
+				SystemTimeCount = Sim_Now() - start;
+			}
+			Dev.DevStatusUpgrade(status, 10 * 60 * 1000, 1, 0);
+		}
+
+		//传感器每秒随机变化
+		if(SystemTimeCount - last_sensor >= 1000)
+		{
+			last_sensor = SystemTimeCount;
+			status.Temperature += (int8_t)(Sim_Rand() % 3) - 1;
+			status.Humidity += (int8_t)(Sim_Rand() % 5) - 2;
+			Pro_P0Set<Kidsbox_Infrared>(status, (Sim_Rand() % 20) == 0);
+			Dev_StatusVersion++;
+		}
+		Dev.DevStatusUpgrade(status, 10 * 60 * 1000, 0, 0);
+	}
+
+	ack = Dev.GetAckStat();
+	rxs = Dev.GetRxStat();
+	printf("\n[device] ack: sent %u resent %u acked %u late %u gave-up %u srtt %u ms rttvar %u ms rto %u ms\n",
+		ack->Send_Num, ack->Resend_Num, ack->Ack_Num, ack->AckLate_Num, ack->GiveUp_Num,
+		ack->SRtt, ack->RttVar, ack->Rto);
+	printf("[device] rx: frames %u sum-err %u len-err %u resync %u timeout %u dropped %u overflow %u busy %u\n",
+		rxs->Frame_Num, rxs->SumErr_Num, rxs->LenErr_Num, rxs->Resync_Num,
+		rxs->Timeout_Num, rxs->Drop_Num, rxs->Overflow_Num, rxs->Busy_Num);
+	printf("[device] controls executed %u, duplicates ACKed only %u\n", executed, rxs->Dup_Num);
+	if(SimOpt.StreamLen)
+	{
+		printf("[device] streams received %u, failed %u, echoed %u\n", Dev_StreamOk, Dev_StreamFail, echoed);
+	}
+#if (GIZ_TRACE == 1)
+	if(SimOpt.Trace != NULL && (dev_trace = fopen(SimOpt.Trace, "wb")) != NULL)
+	{
+		printf("[device] trace: %u bytes -> %s\n", GizTrace_Dump(Dev_TracePut), SimOpt.Trace);
+		fclose(dev_trace);
+	}
+#else
+	if(SimOpt.Trace != NULL)
+		printf("[device] trace: not built in, rebuild with -DGIZ_TRACE=1\n");
+#endif
+	fflush(stdout);
+}
+
+/*****************************************************
+* 模组一侧
+******************************************************/
+typedef struct
+{
+	uint32_t				Due;		//何时写出(ms)
+	std::vector<uint8_t>	Wire;		//已转义的字节
+}SimTxTypeDef;
+
+typedef struct
+{
+	uint8_t			Cmd;
+	uint8_t			SN;
+	uint8_t			Kind;		//统计分类
+	uint8_t			Retries;	//已重发次数
+	uint32_t		SendTime;
+	uint32_t		RetryTime;	//最近一次发出的时间
+	std::vector<uint8_t>	Raw;	//未转义的帧，重发时使用
+}SimPendingTypeDef;
+
+typedef enum
+{
+	Kind_Info,
+	Kind_Heartbeat,
+	Kind_Control,
+	Kind_Read,
+	Kind_WifiStatus,
+	Kind_Stream,
+	Kind_Num,
+}SimKindTypeDef;
+
+static const char *Kind_Name[Kind_Num] = { "device-info", "heartbeat", "p0-control", "p0-read", "wifi-status", "p0-stream" };
+
+typedef struct
+{
+	uint32_t				Sent;
+	uint32_t				Answered;
+	uint32_t				Lost;
+	std::vector<uint32_t>	Rtt;
+}SimKindStatTypeDef;
+
+typedef struct
+{
+	uint32_t		Frames_Tx;
+	uint32_t		Frames_Rx;
+	uint32_t		Frames_RxBad;		//校验错误
+	uint32_t		Frames_TxDropped;	//模拟丢失的模组帧
+	uint32_t		Frames_RxDropped;	//模拟丢失的设备帧
+	uint32_t		Frames_Corrupted;
+	uint32_t		Reports;			//设备主动上报(含重发)
+	uint32_t		Reports_Dup;		//重复SN的上报，即设备重发
+	uint32_t		Errors;				//设备回复的非法消息通知
+	uint32_t		Retried;			//模组重发的请求帧
+	uint32_t		Reports_Offline;	//云端断开期间收到的设备上报
+	uint32_t		Echo_Good;			//设备发回的透传帧，长度和内容正确
+	uint32_t		Echo_Bad;
+	SimKindStatTypeDef	Kind[Kind_Num];
+}SimStatTypeDef;
+
+static std::vector<SimTxTypeDef> Sim_TxQueue;
+static std::vector<SimPendingTypeDef> Sim_Pending;
+static SimStatTypeDef Sim_Stat;
+static uint8_t Sim_SN = 0;
+static uint8_t Sim_ReportSeen[256];
+static uint8_t Sim_Offline = 0;
+
+static void Sim_Queue(const uint8_t *raw, uint16_t len, uint32_t now)
+{
+	SimTxTypeDef tx;
+	std::vector<uint8_t> wire(len * 2);
+	uint16_t n;
+
+	if(Sim_Chance(SimOpt.Loss))
+	{
+		Sim_Stat.Frames_TxDropped++;
+		return;
+	}
+	n = HostFrame_Escape(wire.data(), raw, len);
+	if(Sim_Chance(SimOpt.Corrupt))
+	{
+		wire[Sim_Rand() % n] ^= (uint8_t)(1 + Sim_Rand() % 255);
+		Sim_Stat.Frames_Corrupted++;
+	}
+	tx.Due = now + SimOpt.Latency + (SimOpt.Jitter ? Sim_Rand() % (SimOpt.Jitter + 1) : 0);
+	tx.Wire.assign(wire.begin(), wire.begin() + n);
+	Sim_TxQueue.push_back(tx);
+}
+
+static void Sim_Request(uint8_t cmd, const uint8_t *data, uint16_t len, SimKindTypeDef kind, uint32_t now)
+{
+	std::vector<uint8_t> raw(8 + len + 1);
+	SimPendingTypeDef p;
+	uint16_t n;
+
+	p.Cmd = cmd;
+	p.SN = Sim_SN++;
+	p.Kind = kind;
+	p.Retries = 0;
+	p.SendTime = now;
+	p.RetryTime = now;
+	n = HostFrame_Build(raw.data(), cmd, p.SN, data, len);
+	p.Raw.assign(raw.begin(), raw.begin() + n);
+	Sim_Pending.push_back(p);
+	Sim_Stat.Kind[kind].Sent++;
+	Sim_Queue(raw.data(), n, now);
+}
+
+static void Sim_Ack(uint8_t cmd, uint8_t sn, uint32_t now)
+{
+	uint8_t raw[16];
+	uint16_t n = HostFrame_Build(raw, cmd, sn, NULL, 0);
+
+	Sim_Queue(raw, n, now);
+}
+
+//处理设备发来的一帧(已去转义)
+static void Sim_OnFrame(const uint8_t *f, uint16_t len, uint32_t now)
+{
+	uint16_t i;
+	uint8_t cmd = f[4];
+	uint8_t sn = f[5];
+
+	if(HostFrame_SumOk(f, len) == 0)
+	{
+		Sim_Stat.Frames_RxBad++;
+		return;
+	}
+	if(Sim_Chance(SimOpt.Loss))
+	{
+		Sim_Stat.Frames_RxDropped++;
+		return;
+	}
+	Sim_Stat.Frames_Rx++;
+
+	switch(cmd)
+	{
+		case Pro_D2W_P0_Cmd:
+			if(len > 9 && f[8] == P0_D2W_Transparent_Action)
+			{
+				//透传帧：应与最近发出的长度相同，内容按种子递增
+				for(i = 10; i < len - 1 && f[i] == Sim_StreamByte(f[9], i - 9); i++);
+				if((uint32_t)(len - 10) == SimOpt.StreamLen && i == len - 1)
+				{
+					Sim_Stat.Echo_Good++;
+				}
+				else
+				{
+					Sim_Stat.Echo_Bad++;
+				}
+				Sim_Ack(Pro_W2D_P0_Ack_Cmd, sn, now);
+				return;
+			}
+			Sim_Stat.Reports++;
+			if(Sim_Offline)
+			{
+				Sim_Stat.Reports_Offline++;
+			}
+			if(Sim_ReportSeen[sn])
+			{
+				Sim_Stat.Reports_Dup++;
+			}
+			Sim_ReportSeen[sn] = 1;
+			Sim_ReportSeen[(uint8_t)(sn + 128)] = 0;
+			Sim_Ack(Pro_W2D_P0_Ack_Cmd, sn, now);
+			return;
+		case Pro_D2W_ControlWifi_Config_Cmd:
+			Sim_Ack(Pro_W2D_ControlWifi_Config_Ack_Cmd, sn, now);
+			return;
+		case Pro_D2W_ResetWifi_Cmd:
+			Sim_Ack(Pro_W2D_ResetWifi_Ack_Cmd, sn, now);
+			return;
+		case Pro_D2W_ErrorPackage_Ack_Cmd:
+			Sim_Stat.Errors++;
+			return;
+		default:
+			break;
+	}
+
+	//其余为对模组请求的回复
+	for(i = 0; i < Sim_Pending.size(); i++)
+	{
+		if(Sim_Pending[i].Cmd + 1 == cmd && Sim_Pending[i].SN == sn)
+		{
+			SimKindStatTypeDef *k = &Sim_Stat.Kind[Sim_Pending[i].Kind];
+
+			k->Answered++;
+			k->Rtt.push_back(now - Sim_Pending[i].SendTime);
+			Sim_Pending.erase(Sim_Pending.begin() + i);
+			return;
+		}
+	}
+}
+
+static void Sim_Percentiles(const char *name, SimKindStatTypeDef *k)
+{
+	std::vector<uint32_t> &r = k->Rtt;
+	double loss = k->Sent ? 100.0 * k->Lost / k->Sent : 0.0;
+
+	std::sort(r.begin(), r.end());
+	if(r.empty())
+	{
+		printf("%-12s %6u %6u %6u %6.2f%% %6s %6s %6s %6s\n", name, k->Sent, k->Answered, k->Lost, loss, "-", "-", "-", "-");
+		return;
+	}
+	printf("%-12s %6u %6u %6u %6.2f%% %6u %6u %6u %6u\n", name, k->Sent, k->Answered, k->Lost, loss,
+		r[r.size() * 50 / 100], r[r.size() * 90 / 100], r[r.size() * 99 / 100], r.back());
+}
+
+static void Sim_Report(uint32_t elapsed)
+{
+	double sec = elapsed / 1000.0;
+	int i;
+
+	printf("[module] %.1f s, latency %u+%u ms, loss %.2f%%, corrupt %.2f%%, pace %u us/byte\n",
+		sec, SimOpt.Latency, SimOpt.Jitter, SimOpt.Loss, SimOpt.Corrupt, SimOpt.Pace);
+	printf("[module] frames tx %u (%.1f/s, dropped %u, corrupted %u)  rx %u (%.1f/s, bad %u, dropped %u)\n",
+		Sim_Stat.Frames_Tx, Sim_Stat.Frames_Tx / sec, Sim_Stat.Frames_TxDropped, Sim_Stat.Frames_Corrupted,
+		Sim_Stat.Frames_Rx, Sim_Stat.Frames_Rx / sec, Sim_Stat.Frames_RxBad, Sim_Stat.Frames_RxDropped);
+	printf("[module] device reports %u, resent %u, error notices %u, requests retried %u\n",
+		Sim_Stat.Reports, Sim_Stat.Reports_Dup, Sim_Stat.Errors, Sim_Stat.Retried);
+	if(SimOpt.OutageLen)
+	{
+		printf("[module] cloud outage %u ms at %u ms: device reports during outage %u\n",
+			SimOpt.OutageLen, SimOpt.OutageStart, Sim_Stat.Reports_Offline);
+	}
+	if(SimOpt.StreamLen)
+	{
+		printf("[module] %u-byte transparent frames echoed back %u, bad %u\n",
+			SimOpt.StreamLen, Sim_Stat.Echo_Good, Sim_Stat.Echo_Bad);
+	}
+	printf("%-12s %6s %6s %6s %7s %6s %6s %6s %6s\n", "request", "sent", "acked", "lost", "loss", "p50", "p90", "p99", "max");
+	for(i = 0; i < Kind_Num; i++)
+	{
+		Sim_Percentiles(Kind_Name[i], &Sim_Stat.Kind[i]);
+	}
+	fflush(stdout);
+}
+
+static void Sim_Run(int fd)
+{
+	HostFrame_ParserTypeDef parser;
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	uint8_t rx[256];
+	uint8_t data[16];
+	std::vector<uint8_t> stream(SimOpt.StreamLen + 1);
+	uint32_t start = Sim_Now();
+	uint32_t now = start;
+	uint32_t next[Kind_Num];
+	ssize_t n;
+	size_t i;
+	uint16_t len;
+
+	memset(&parser, 0, sizeof(parser));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	for(i = 0; i < Kind_Num; i++)
+	{
+		next[i] = start + 200;
+	}
+	Sim_Request(Pro_W2D_GetDeviceInfo_Cmd, NULL, 0, Kind_Info, now);
+	next[Kind_Info] = 0xFFFFFFFF;
+	if(SimOpt.StreamLen == 0)
+	{
+		next[Kind_Stream] = 0xFFFFFFFF;
+	}
+
+	while((now = Sim_Now()) - start < SimOpt.Duration)
+	{
+		//云端断开和恢复时模组立即通知WiFi状态
+		if(SimOpt.OutageLen && Sim_Offline != (now - start >= SimOpt.OutageStart && now - start < SimOpt.OutageStart + SimOpt.OutageLen))
+		{
+			Sim_Offline = !Sim_Offline;
+			next[Kind_WifiStatus] = now;
+		}
+		if(now >= next[Kind_Heartbeat])
+		{
+			Sim_Request(Pro_W2D_Heartbeat_Cmd, NULL, 0, Kind_Heartbeat, now);
+			next[Kind_Heartbeat] = now + SimOpt.Heartbeat;
+		}
+		if(now >= next[Kind_Control])
+		{
+			data[0] = P0_W2D_Control_Devce_Action;
+			data[1] = 0x1C;		//LED_R | LED_G | LED_B
+			data[2] = 0;
+			data[3] = (uint8_t)Sim_Rand();
+			data[4] = (uint8_t)Sim_Rand();
+			data[5] = (Sim_Rand() & 1) ? 0xFF : (uint8_t)Sim_Rand();
+			data[6] = 0;
+			data[7] = 5;
+			Sim_Request(Pro_W2D_P0_Cmd, data, 8, Kind_Control, now);
+			next[Kind_Control] = now + SimOpt.Control;
+		}
+		if(now >= next[Kind_Read])
+		{
+			data[0] = P0_W2D_ReadDevStatus_Action;
+			Sim_Request(Pro_W2D_P0_Cmd, data, 1, Kind_Read, now);
+			next[Kind_Read] = now + SimOpt.Read;
+		}
+		if(now >= next[Kind_WifiStatus])
+		{
+			data[0] = 0;
+			data[1] = Sim_Offline ? Wifi_StationMode : (Wifi_StationMode | Wifi_ConnRouter | Wifi_ConnClouds);
+			Sim_Request(Pro_W2D_ReportWifiStatus_Cmd, data, 2, Kind_WifiStatus, now);
+			next[Kind_WifiStatus] = now + SimOpt.WifiStatus;
+		}
+		if(now >= next[Kind_Stream])
+		{
+			stream[0] = P0_W2D_Transparent_Action;
+			for(i = 0; i < SimOpt.StreamLen; i++)
+			{
+				stream[1 + i] = Sim_StreamByte((uint8_t)Sim_SN, i);
+			}
+			Sim_Request(Pro_W2D_P0_Cmd, stream.data(), stream.size(), Kind_Stream, now);
+			next[Kind_Stream] = now + SimOpt.StreamPeriod;
+		}
+
+		//到期的帧写出
+		for(i = 0; i < Sim_TxQueue.size(); )
+		{
+			if((int32_t)(now - Sim_TxQueue[i].Due) < 0)
+			{
+				i++;
+				continue;
+			}
+			if(SimOpt.Pace == 0)
+			{
+				Sim_WriteAll(fd, Sim_TxQueue[i].Wire.data(), Sim_TxQueue[i].Wire.size());
+			}
+			else
+			{
+				for(size_t b = 0; b < Sim_TxQueue[i].Wire.size(); b++)
+				{
+					Sim_WriteAll(fd, &Sim_TxQueue[i].Wire[b], 1);
+					usleep(SimOpt.Pace);
+				}
+			}
+			Sim_Stat.Frames_Tx++;
+			Sim_TxQueue.erase(Sim_TxQueue.begin() + i);
+		}
+
+		//超时未回复的请求视为丢失；开启重发时先用相同SN重发，与 GAgent 相同最多两次
+		for(i = 0; i < Sim_Pending.size(); )
+		{
+			if(SimOpt.Retry && Sim_Pending[i].Retries < 2 && now - Sim_Pending[i].RetryTime >= SimOpt.Retry)
+			{
+				Sim_Pending[i].Retries++;
+				Sim_Pending[i].RetryTime = now;
+				Sim_Stat.Retried++;
+				Sim_Queue(Sim_Pending[i].Raw.data(), Sim_Pending[i].Raw.size(), now);
+			}
+			if(now - Sim_Pending[i].SendTime > SimOpt.Timeout)
+			{
+				Sim_Stat.Kind[Sim_Pending[i].Kind].Lost++;
+				Sim_Pending.erase(Sim_Pending.begin() + i);
+				continue;
+			}
+			i++;
+		}
+
+		if(poll(&pfd, 1, 1) > 0)
+		{
+			n = read(fd, rx, sizeof(rx));
+			if(n == 0)
+			{
+				break;
+			}
+			for(i = 0; n > 0 && i < (size_t)n; i++)
+			{
+				if((len = HostFrame_Parse(&parser, rx[i])) != 0)
+				{
+					Sim_OnFrame(parser.Buf, len, Sim_Now());
+				}
+			}
+		}
+	}
+
+	//仍在等待的请求不计入丢失
+	Sim_Report(Sim_Now() - start);
+}
+
+static int Sim_OpenTty(const char *path)
+{
+	struct termios tio;
+	int fd = open(path, O_RDWR | O_NOCTTY);
+
+	if(fd < 0)
+	{
+		perror(path);
+		exit(1);
+	}
+	if(tcgetattr(fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, B9600);
+		cfsetospeed(&tio, B9600);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+static void Sim_Usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  --duration MS    run time (10000)\n"
+		"  --latency MS     module response latency (20)\n"
+		"  --jitter MS      extra random latency (10)\n"
+		"  --loss PCT       frame loss per direction (0)\n"
+		"  --corrupt PCT    one corrupted byte per module frame (0)\n"
+		"  --pace US        delay between module bytes (0)\n"
+		"  --heartbeat MS   heartbeat period (1000)\n"
+		"  --control MS     P0 control period (700)\n"
+		"  --read MS        P0 read-status period (1500)\n"
+		"  --wifi MS        wifi status period (5000)\n"
+		"  --timeout MS     request counted lost after (2000)\n"
+		"  --actuate MS     device actuates each control for this long (0)\n"
+		"  --block          actuation blocks the device loop instead of running beside it\n"
+		"  --retry MS       resend unanswered requests with the same SN, twice (0 = off)\n"
+		"  --outage AT:MS   drop the cloud link at AT ms for MS ms (wifi status without ConnClouds)\n"
+		"  --stream LEN:MS  send a LEN-byte transparent P0 frame every MS ms; the device echoes it (LEN <= 1000)\n"
+		"  --seed N         random seed (1)\n"
+		"  --tty PATH       talk to a serial port/pty instead of the built-in device\n"
+		"  --trace FILE     save the built-in device's UART trace on exit (build with -DGIZ_TRACE=1)\n"
+		"  --debug          copy the built-in device's mySerial output to stderr\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] =
+	{
+		{ "duration",  required_argument, NULL, 'd' },
+		{ "latency",   required_argument, NULL, 'l' },
+		{ "jitter",    required_argument, NULL, 'j' },
+		{ "loss",      required_argument, NULL, 'L' },
+		{ "corrupt",   required_argument, NULL, 'c' },
+		{ "pace",      required_argument, NULL, 'p' },
+		{ "heartbeat", required_argument, NULL, 'H' },
+		{ "control",   required_argument, NULL, 'C' },
+		{ "read",      required_argument, NULL, 'r' },
+		{ "wifi",      required_argument, NULL, 'w' },
+		{ "timeout",   required_argument, NULL, 't' },
+		{ "actuate",   required_argument, NULL, 'a' },
+		{ "seed",      required_argument, NULL, 's' },
+		{ "tty",       required_argument, NULL, 'T' },
+		{ "trace",     required_argument, NULL, 'R' },
+		{ "debug",     no_argument,       NULL, 'D' },
+		{ "block",     no_argument,       NULL, 'B' },
+		{ "retry",     required_argument, NULL, 'y' },
+		{ "outage",    required_argument, NULL, 'o' },
+		{ "stream",    required_argument, NULL, 'S' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int sv[2];
+	int c;
+	pid_t pid;
+
+	while((c = getopt_long(argc, argv, "", opts, NULL)) != -1)
+	{
+		switch(c)
+		{
+			case 'd': SimOpt.Duration = strtoul(optarg, NULL, 0); break;
+			case 'l': SimOpt.Latency = strtoul(optarg, NULL, 0); break;
+			case 'j': SimOpt.Jitter = strtoul(optarg, NULL, 0); break;
+			case 'L': SimOpt.Loss = strtod(optarg, NULL); break;
+			case 'c': SimOpt.Corrupt = strtod(optarg, NULL); break;
+			case 'p': SimOpt.Pace = strtoul(optarg, NULL, 0); break;
+			case 'H': SimOpt.Heartbeat = strtoul(optarg, NULL, 0); break;
+			case 'C': SimOpt.Control = strtoul(optarg, NULL, 0); break;
+			case 'r': SimOpt.Read = strtoul(optarg, NULL, 0); break;
+			case 'w': SimOpt.WifiStatus = strtoul(optarg, NULL, 0); break;
+			case 't': SimOpt.Timeout = strtoul(optarg, NULL, 0); break;
+			case 'a': SimOpt.Actuate = strtoul(optarg, NULL, 0); break;
+			case 's': SimOpt.Seed = strtoul(optarg, NULL, 0); break;
+			case 'T': SimOpt.Tty = optarg; break;
+			case 'R': SimOpt.Trace = optarg; break;
+			case 'D': SimOpt.Debug = 1; break;
+			case 'B': SimOpt.Block = 1; break;
+			case 'y': SimOpt.Retry = strtoul(optarg, NULL, 0); break;
+			case 'o':
+				if(sscanf(optarg, "%u:%u", &SimOpt.OutageStart, &SimOpt.OutageLen) != 2)
+				{
+					Sim_Usage(argv[0]);
+				}
+				break;
+			case 'S':
+				if(sscanf(optarg, "%u:%u", &SimOpt.StreamLen, &SimOpt.StreamPeriod) != 2 ||
+					SimOpt.StreamLen == 0 || SimOpt.StreamLen > 1000)
+				{
+					Sim_Usage(argv[0]);
+				}
+				break;
+			default: Sim_Usage(argv[0]);
+		}
+	}
+	rnd_state = SimOpt.Seed;
+	signal(SIGPIPE, SIG_IGN);
+
+	if(SimOpt.Tty != NULL)
+	{
+		Sim_Run(Sim_OpenTty(SimOpt.Tty));
+		return 0;
+	}
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	pid = fork();
+	if(pid == 0)
+	{
+		close(sv[0]);
+		rnd_state = SimOpt.Seed * 7 + 1;
+		Dev_Run(sv[1]);
+		_exit(0);
+	}
+	close(sv[1]);
+	Sim_Run(sv[0]);
+	shutdown(sv[0], SHUT_WR);
+	waitpid(pid, NULL, 0);
+	return 0;
+}
@@ -0,0 +1,66 @@
+/********************************************************
+*
+* @file      [Arduino.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     主机(Linux)编译用的 Arduino 最小替身
+*            只提供 GizWits 库用到的类型和函数，使 GizWits.cpp、
+*            GizLog.cpp 可以不经修改地在主机上编译运行。
+*            调试打印(mySerial)默认丢弃，HostPrint_Enable(1) 后输出到 stderr。
+*
+*********************************************************/
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX					16
+#define DEC					10
+
+#define PROGMEM
+#define F(s)				(s)
+#define PSTR(s)				(s)
+#define memcpy_P			memcpy
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+#define pgm_read_word(p)	(*(const uint16_t *)(p))
+#define pgm_read_ptr(p)		(*(void * const *)(p))
+
+//主机上指针为8字节，ACK窗口和发送队列比AVR大，RAM预算按主机放宽
+#ifndef GIZ_RAM_BUDGET
+#define GIZ_RAM_BUDGET		4096
+#endif
+
+extern uint8_t HostPrint_On;
+static inline void HostPrint_Enable(uint8_t on) { HostPrint_On = on; }
+
+class HostPrint
+{
+public:
+	void begin(long) {}
+	void print(const char *s) { if(HostPrint_On) fputs(s, stderr); }
+	void println(const char *s = "") { if(HostPrint_On) fprintf(stderr, "%s\n", s); }
+	template <typename T> void print(T v, int base = DEC)
+	{
+		if(HostPrint_On) fprintf(stderr, base == HEX ? "%lX" : "%ld", (long)v);
+	}
+	template <typename T> void println(T v, int base = DEC)
+	{
+		print(v, base);
+		println();
+	}
+	size_t write(uint8_t c) { if(HostPrint_On) fputc(c, stderr); return 1; }
+};
+
+unsigned long millis(void);
+void delay(unsigned long ms);
+
+#endif
@@ -0,0 +1,184 @@
+/********************************************************
+*
+* @file      [GizUart_host.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     GizUart 的主机实现，代替 GizUart.cpp 中的寄存器和中断部分
+*
+*********************************************************/
+#include "GizUart_host.h"
+#include <GizTrace.h>
+
+RingBuffer<GIZ_RX_RING_SIZE> u_ring_buff;
+uint8_t HostPrint_On = 0;
+
+static uint16_t rx_overflow = 0;
+static uint32_t tx_bytes = 0;
+static HostUart_SinkFunc tx_sink = NULL;
+static void *tx_sink_arg = NULL;
+
+//已发出、尚未通知回调的帧
+static GizUart_TxFrameTypeDef tx_frame[GIZ_TX_QUEUE_LEN];
+static uint8_t tx_frame_tail = 0;
+static uint8_t tx_frame_free = 0;
+
+unsigned long millis(void)
+{
+	return SystemTimeCount;
+}
+
+void delay(unsigned long ms)
+{
+	SystemTimeCount += ms;
+}
+
+void GizUart_Init(uint32_t baud)
+{
+	rb_new(&u_ring_buff);
+	tx_frame_tail = tx_frame_free = 0;
+}
+
+void HostUart_SetSink(HostUart_SinkFunc Sink, void *arg)
+{
+	tx_sink = Sink;
+	tx_sink_arg = arg;
+}
+
+/*******************************************************************************
+* Function Name  : HostUart_Rx
+* Description    : 模拟串口接收中断，环形缓冲区满时丢弃并计数
+* Input          : Buf:线上收到的字节； Len:字节数
+* Output         : None
+* Return         : 实际写入的字节数
+* Attention		   : None
+*******************************************************************************/
+uint16_t HostUart_Rx(const uint8_t *Buf, uint16_t Len)
+{
+	uint16_t i;
+	uint16_t n = 0;
+
+	for(i = 0; i < Len; i++)
+	{
+		GIZ_TRACE_BYTE(GIZ_TRACE_RX, Buf[i]);
+		if(rb_put(&u_ring_buff, Buf[i]))
+		{
+			n++;
+		}
+		else
+		{
+			rx_overflow++;
+		}
+	}
+	return n;
+}
+
+uint32_t HostUart_TxBytes(void)
+{
+	return tx_bytes;
+}
+
+uint8_t GizUart_Send(const uint8_t *Buf, uint16_t Len, GizUart_TxDoneFunc Done, void *Arg)
+{
+	GizUart_SegTypeDef seg;
+
+	if(Len > GIZ_TX_RING_SIZE)
+	{
+		return 0;
+	}
+	seg.Buf = Buf;
+	seg.Len = Len;
+	seg.Type = GIZ_SEG_COPY;
+	return GizUart_SendV(&seg, 1, Done, Arg);
+}
+
+/*******************************************************************************
+* Function Name  : GizUart_SendV
+* Description    : 主机上立即按线上格式转义并交给输出回调，完成回调仍在 GizUart_Poll 中调用
+* Input          : Seg:分段； SegNum:分段数； Done:发送完成回调； Arg:回调参数
+* Output         : None
+* Return         : 1:已发出； 0:分段非法
+* Attention		   : 与 AVR 实现相同的参数检查
+*******************************************************************************/
+uint8_t GizUart_SendV(const GizUart_SegTypeDef *Seg, uint8_t SegNum, GizUart_TxDoneFunc Done, void *Arg)
+{
+	uint8_t wire[GIZ_TX_MAX_SEG * 255 * 2];
+	uint16_t n = 0;
+	uint16_t pos;
+	uint16_t len = 0;
+	uint16_t copy = 0;
+	uint16_t i;
+	uint8_t k;
+	GizUart_TxFrameTypeDef *frame;
+
+	if(SegNum == 0 || SegNum > GIZ_TX_MAX_SEG)
+	{
+		return 0;
+	}
+	pos = (Seg[0].Type & GIZ_SEG_CONT) ? 2 : 0;
+	for(k = 0; k < SegNum; k++)
+	{
+		if(GIZ_SEG_TYPE(Seg[k].Type) == GIZ_SEG_COPY)
+		{
+			copy += Seg[k].Len;
+		}
+		for(i = 0; i < Seg[k].Len; i++, pos++, len++)
+		{
+			wire[n++] = Seg[k].Buf[i];
+			if(pos >= 2 && Seg[k].Buf[i] == 0xFF)
+			{
+				wire[n++] = 0x55;
+			}
+		}
+	}
+	if(len == 0 || copy > GIZ_TX_RING_SIZE)
+	{
+		return 0;
+	}
+	for(i = 0; i < n; i++)
+	{
+		GIZ_TRACE_BYTE(GIZ_TRACE_TX, wire[i]);
+	}
+	tx_bytes += n;
+	if(tx_sink != NULL)
+	{
+		tx_sink(wire, n, tx_sink_arg);
+	}
+
+	if((uint8_t)(tx_frame_tail - tx_frame_free) >= GIZ_TX_QUEUE_LEN)
+	{
+		GizUart_Poll();
+	}
+	frame = &tx_frame[tx_frame_tail & (GIZ_TX_QUEUE_LEN - 1)];
+	frame->Len = len;
+	frame->Done = Done;
+	frame->Arg = Arg;
+	tx_frame_tail++;
+	return 1;
+}
+
+void GizUart_Poll(void)
+{
+	GizUart_TxFrameTypeDef *frame;
+
+	while(tx_frame_free != tx_frame_tail)
+	{
+		frame = &tx_frame[tx_frame_free & (GIZ_TX_QUEUE_LEN - 1)];
+		tx_frame_free++;
+		if(frame->Done != NULL)
+		{
+			frame->Done(frame->Arg);
+		}
+	}
+}
+
+uint8_t GizUart_TxIdle(void)
+{
+	return 1;
+}
+
+uint16_t GizUart_RxOverflow(void)
+{
+	return rx_overflow;
+}
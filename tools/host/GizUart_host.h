@@ -0,0 +1,24 @@
+/********************************************************
+*
+* @file      [GizUart_host.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     GizUart 的主机实现附加接口
+*            HostUart_Rx 相当于串口接收中断，逐字节写入 u_ring_buff；
+*            GizUart_Send 发出的帧按线上格式(已转义)交给 HostUart_SetSink 设置的回调。
+*
+*********************************************************/
+#ifndef _GIZUART_HOST_H
+#define _GIZUART_HOST_H
+
+#include <GizUart.h>
+
+typedef void (*HostUart_SinkFunc)(const uint8_t *Buf, uint16_t Len, void *arg);
+
+void HostUart_SetSink(HostUart_SinkFunc Sink, void *arg);
+uint16_t HostUart_Rx(const uint8_t *Buf, uint16_t Len);
+uint32_t HostUart_TxBytes(void);
+
+#endif
@@ -0,0 +1,145 @@
+/********************************************************
+*
+* @file      [HostFrame.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     主机工具共用的帧构造及转义函数
+*            帧格式与 GizWits.h 一致：FF FF | Len(大端) | Cmd | SN | Flags[2] | 数据 | Sum
+*
+*********************************************************/
+#ifndef _HOST_FRAME_H
+#define _HOST_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HostFrame_Max		64		//工具中构造的未转义帧的最大长度
+#define HostFrame_ParseMax	1024	//解析时可组帧的最大长度，容纳分块发送的长帧
+
+/*******************************************************************************
+* Function Name  : HostFrame_Build
+* Description    : 构造一帧(未转义)
+* Input          : cmd:命令字； sn:序号； data:命令字后的数据(Flags之后)； len:数据长度
+* Output         : out:帧
+* Return         : 帧长度
+* Attention		   : None
+*******************************************************************************/
+static inline uint16_t HostFrame_Build(uint8_t *out, uint8_t cmd, uint8_t sn, const uint8_t *data, uint16_t len)
+{
+	uint16_t total = 8 + len + 1;
+	uint8_t sum = 0;
+	uint16_t i;
+
+	out[0] = 0xFF;
+	out[1] = 0xFF;
+	out[2] = (uint8_t)((total - 4) >> 8);
+	out[3] = (uint8_t)(total - 4);
+	out[4] = cmd;
+	out[5] = sn;
+	out[6] = 0;
+	out[7] = 0;
+	if(len)
+	{
+		memcpy(out + 8, data, len);
+	}
+	for(i = 2; i < total - 1; i++)
+	{
+		sum += out[i];
+	}
+	out[total - 1] = sum;
+	return total;
+}
+
+/*******************************************************************************
+* Function Name  : HostFrame_Escape
+* Description    : 按线上格式转义：帧头之后的 0xFF 后补 0x55
+* Input          : frame:未转义的帧； len:长度
+* Output         : out:转义后的字节，空间至少 2 * len
+* Return         : 转义后长度
+* Attention		   : None
+*******************************************************************************/
+static inline uint16_t HostFrame_Escape(uint8_t *out, const uint8_t *frame, uint16_t len)
+{
+	uint16_t n = 0;
+	uint16_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		out[n++] = frame[i];
+		if(i >= 2 && frame[i] == 0xFF)
+		{
+			out[n++] = 0x55;
+		}
+	}
+	return n;
+}
+
+//线上字节流的去转义解析状态
+typedef struct
+{
+	uint8_t		Buf[HostFrame_ParseMax];
+	uint16_t	Count;
+	uint16_t	Len;
+	uint8_t		Last;
+}HostFrame_ParserTypeDef;
+
+/*******************************************************************************
+* Function Name  : HostFrame_Parse
+* Description    : 逐字节去转义并组帧，遇到 FF FF 重新开始
+* Input          : p:解析状态，初始全0； value:线上字节
+* Output         : p->Buf:完整的帧(未转义)
+* Return         : 帧长度，帧未完整时为0
+* Attention		   : 不检查校验和，见 HostFrame_SumOk
+*******************************************************************************/
+static inline uint16_t HostFrame_Parse(HostFrame_ParserTypeDef *p, uint8_t value)
+{
+	uint16_t len;
+
+	if(p->Last == 0xFF && value == 0xFF)
+	{
+		p->Buf[0] = p->Buf[1] = 0xFF;
+		p->Count = 2;
+		p->Len = 0;
+		p->Last = 0;
+		return 0;
+	}
+	if(p->Last == 0xFF && value == 0x55 && p->Count > 2)
+	{
+		p->Last = 0;
+		return 0;
+	}
+	p->Last = value;
+	if(p->Count < 2 || p->Count >= sizeof(p->Buf))
+	{
+		return 0;
+	}
+	p->Buf[p->Count++] = value;
+	if(p->Count == 4)
+	{
+		p->Len = ((uint16_t)p->Buf[2] << 8 | p->Buf[3]) + 4;
+	}
+	if(p->Count > 4 && p->Count == p->Len)
+	{
+		len = p->Len;
+		p->Count = 0;
+		p->Last = 0;
+		return len;
+	}
+	return 0;
+}
+
+static inline uint8_t HostFrame_SumOk(const uint8_t *frame, uint16_t len)
+{
+	uint8_t sum = 0;
+	uint16_t i;
+
+	for(i = 2; i < len - 1; i++)
+	{
+		sum += frame[i];
+	}
+	return sum == frame[len - 1];
+}
+
+#endif
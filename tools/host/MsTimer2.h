@@ -0,0 +1,22 @@
+/********************************************************
+*
+* @file      [MsTimer2.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     主机编译用的 MsTimer2 替身
+*            主机上由工具自己推进 SystemTimeCount，定时器不做任何事。
+*
+*********************************************************/
+#ifndef _HOST_MSTIMER2_H
+#define _HOST_MSTIMER2_H
+
+namespace MsTimer2
+{
+	static inline void set(unsigned long, void (*)()) {}
+	static inline void start() {}
+	static inline void stop() {}
+}
+
+#endif
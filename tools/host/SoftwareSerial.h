@@ -0,0 +1,22 @@
+/********************************************************
+*
+* @file      [SoftwareSerial.h]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     主机编译用的 SoftwareSerial 替身，输出交给 HostPrint
+*
+*********************************************************/
+#ifndef _HOST_SOFTWARESERIAL_H
+#define _HOST_SOFTWARESERIAL_H
+
+#include <Arduino.h>
+
+class SoftwareSerial : public HostPrint
+{
+public:
+	SoftwareSerial(uint8_t, uint8_t) {}
+};
+
+#endif
@@ -0,0 +1,135 @@
+/********************************************************
+*
+* @file      [log_decode.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     二进制调试日志解码(主机)
+*            把 GizLog 从 mySerial 输出的二进制记录还原为文本行，
+*            格式表与设备共用 libraries/GizWits/GizLogFmt.h；
+*            记录之外的字节(sketch 自己的文本打印)原样输出。
+*
+*            编译：
+*            g++ -O2 -Itools/host -Ilibraries/GizWits tools/log_decode.cpp -o log_decode
+*            运行：./log_decode [capture.bin]     不给文件时读标准输入，可接在串口后实时查看：
+*                  stty -F /dev/ttyUSB0 9600 raw && ./log_decode < /dev/ttyUSB0
+*
+*********************************************************/
+#include <GizWits.h>
+#include <GizLog.h>
+
+#define GIZ_LOG_FMT(name, num, fmt)		{ num, fmt },
+static const struct
+{
+	uint8_t		Num;
+	const char	*Fmt;
+}Decode_Fmt[Log_Num] =
+{
+#include <GizLogFmt.h>
+};
+#undef GIZ_LOG_FMT
+
+static uint8_t Decode_Rec[4 + 2 * 3];
+static uint8_t Decode_Len = 0;
+static uint32_t Decode_Time = 0;
+static uint8_t Decode_LineStart = 1;
+
+static void Decode_Raw(const uint8_t *buf, uint8_t len)
+{
+	uint8_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		putchar(buf[i]);
+		Decode_LineStart = (buf[i] == '\n');
+	}
+}
+
+static void Decode_Print(void)
+{
+	uint8_t id = Decode_Rec[1];
+	uint16_t arg[3];
+	const char *fmt = Decode_Fmt[id].Fmt;
+	uint8_t a = 0;
+	uint8_t i;
+
+	for(i = 0; i < Decode_Fmt[id].Num; i++)
+	{
+		arg[i] = Decode_Rec[4 + 2 * i] | ((uint16_t)Decode_Rec[5 + 2 * i] << 8);
+	}
+	Decode_Time += (uint16_t)((Decode_Rec[2] | (Decode_Rec[3] << 8)) - (uint16_t)Decode_Time);
+	if(id == Log_Time)
+	{
+		Decode_Time = ((uint32_t)arg[0] << 16) | arg[1];
+	}
+
+	if(Decode_LineStart == 0)
+	{
+		putchar('\n');
+	}
+	printf("[%u] ", Decode_Time);
+	for(; *fmt; fmt++)
+	{
+		if(*fmt != '%' || fmt[1] == 0)
+		{
+			putchar(*fmt);
+			continue;
+		}
+		switch(*++fmt)
+		{
+			case 'u': printf("%u", arg[a++]); break;
+			case 'x': printf("%X", arg[a++]); break;
+			case 'L': printf("%u", ((uint32_t)arg[a] << 16) | arg[a + 1]); a += 2; break;
+			default: putchar(*fmt); break;
+		}
+	}
+	putchar('\n');
+	Decode_LineStart = 1;
+}
+
+//逐字节解码，不是合法记录的字节当作文本输出
+static void Decode_Byte(uint8_t value)
+{
+	if(Decode_Len == 0 && value != GIZ_LOG_SYNC)
+	{
+		Decode_Raw(&value, 1);
+		return;
+	}
+	Decode_Rec[Decode_Len++] = value;
+	if(Decode_Len == 2 && value >= Log_Num)
+	{
+		//编号非法：起始字节属于文本，第二个字节重新判断
+		Decode_Len = 0;
+		Decode_Raw(Decode_Rec, 1);
+		Decode_Byte(value);
+		return;
+	}
+	if(Decode_Len >= 2 && Decode_Len == 4 + 2 * Decode_Fmt[Decode_Rec[1]].Num)
+	{
+		Decode_Print();
+		Decode_Len = 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *fp = stdin;
+	int c;
+
+	if(argc > 1 && (fp = fopen(argv[1], "rb")) == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	while((c = fgetc(fp)) != EOF)
+	{
+		Decode_Byte((uint8_t)c);
+	}
+	if(Decode_Len != 0)
+	{
+		Decode_Raw(Decode_Rec, Decode_Len);
+	}
+	return 0;
+}
@@ -0,0 +1,852 @@
+/********************************************************
+*
+* @file      [p0_gen.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     P0数据点代码生成(主机)
+*            读取机智云数据点定义(JSON，entities[0].attrs)，生成 sketch 用的头文件：
+*            状态区/控制区的字节结构、每个数据点的位置与取值范围(GizWire.h 中的
+*            Pro_P0Bits/Pro_P0Value)，以及按 Attr_Flags 分发控制命令的模板函数。
+*            布尔和枚举按位存放，同一字节可放多个；数值按大端整字节存放。
+*            attrs 带 position 时严格按其中的位置生成(与云端已定义的产品一致)，
+*            不带时按 id 顺序自动排列：位字段尽量合并进同一字节，可写数据点单独成区。
+*
+*            编译：
+*            g++ -O2 tools/p0_gen.cpp -o p0_gen
+*            运行：./p0_gen [--prefix NAME] product.json [out.h]     不给 out.h 时输出到标准输出
+*
+*********************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/*****************************************************
+* JSON
+******************************************************/
+struct Json
+{
+	enum { Null, Bool, Num, Str, Arr, Obj } Kind;
+	double							Value;
+	std::string						Text;
+	std::vector<Json>				Item;
+	std::vector<std::string>		Key;		//Obj 时与 Item 一一对应
+
+	Json() : Kind(Null), Value(0) {}
+
+	const Json *Get(const char *Name) const
+	{
+		size_t i;
+
+		for(i = 0; i < Key.size(); i++)
+		{
+			if(Key[i] == Name)
+			{
+				return &Item[i];
+			}
+		}
+		return NULL;
+	}
+};
+
+static const char *Json_Src;
+static const char *Json_Pos;
+static const char *Gen_Path;
+
+static void Gen_Fail(const char *fmt, const char *arg)
+{
+	fprintf(stderr, "%s: ", Gen_Path);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static void Json_Fail(const char *what)
+{
+	const char *p;
+	unsigned line = 1;
+
+	for(p = Json_Src; p < Json_Pos; p++)
+	{
+		line += (*p == '\n');
+	}
+	fprintf(stderr, "%s:%u: %s\n", Gen_Path, line, what);
+	exit(1);
+}
+
+static void Json_Space(void)
+{
+	while(*Json_Pos == ' ' || *Json_Pos == '\t' || *Json_Pos == '\r' || *Json_Pos == '\n')
+	{
+		Json_Pos++;
+	}
+}
+
+static void Json_Expect(char c)
+{
+	Json_Space();
+	if(*Json_Pos != c)
+	{
+		Json_Fail("syntax error");
+	}
+	Json_Pos++;
+}
+
+//\uXXXX 转成 UTF-8，代理对按两个字符各自转换(只用于注释)
+static void Json_Utf8(std::string &Out, unsigned c)
+{
+	if(c < 0x80)
+	{
+		Out += (char)c;
+	}
+	else if(c < 0x800)
+	{
+		Out += (char)(0xC0 | (c >> 6));
+		Out += (char)(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		Out += (char)(0xE0 | (c >> 12));
+		Out += (char)(0x80 | ((c >> 6) & 0x3F));
+		Out += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+static std::string Json_String(void)
+{
+	std::string s;
+	unsigned c;
+
+	Json_Expect('"');
+	while(*Json_Pos != '"')
+	{
+		if(*Json_Pos == 0)
+		{
+			Json_Fail("unterminated string");
+		}
+		if(*Json_Pos != '\\')
+		{
+			s += *Json_Pos++;
+			continue;
+		}
+		Json_Pos++;
+		switch(*Json_Pos)
+		{
+			case 'n': s += '\n'; break;
+			case 't': s += '\t'; break;
+			case 'r': s += '\r'; break;
+			case 'b': s += '\b'; break;
+			case 'f': s += '\f'; break;
+			case 'u':
+				if(sscanf(Json_Pos + 1, "%4x", &c) != 1)
+				{
+					Json_Fail("bad \\u escape");
+				}
+				Json_Utf8(s, c);
+				Json_Pos += 4;
+				break;
+			default: s += *Json_Pos; break;
+		}
+		Json_Pos++;
+	}
+	Json_Pos++;
+	return s;
+}
+
+static void Json_Parse(Json &v)
+{
+	char *end;
+
+	Json_Space();
+	switch(*Json_Pos)
+	{
+		case '{':
+			v.Kind = Json::Obj;
+			Json_Pos++;
+			Json_Space();
+			if(*Json_Pos == '}')
+			{
+				Json_Pos++;
+				return;
+			}
+			for(;;)
+			{
+				v.Key.push_back(Json_String());
+				Json_Expect(':');
+				v.Item.push_back(Json());
+				Json_Parse(v.Item.back());
+				Json_Space();
+				if(*Json_Pos == '}')
+				{
+					Json_Pos++;
+					return;
+				}
+				Json_Expect(',');
+			}
+		case '[':
+			v.Kind = Json::Arr;
+			Json_Pos++;
+			Json_Space();
+			if(*Json_Pos == ']')
+			{
+				Json_Pos++;
+				return;
+			}
+			for(;;)
+			{
+				v.Item.push_back(Json());
+				Json_Parse(v.Item.back());
+				Json_Space();
+				if(*Json_Pos == ']')
+				{
+					Json_Pos++;
+					return;
+				}
+				Json_Expect(',');
+			}
+		case '"':
+			v.Kind = Json::Str;
+			v.Text = Json_String();
+			return;
+		default:
+			break;
+	}
+	if(strncmp(Json_Pos, "true", 4) == 0 || strncmp(Json_Pos, "false", 5) == 0)
+	{
+		v.Kind = Json::Bool;
+		v.Value = (*Json_Pos == 't');
+		Json_Pos += (*Json_Pos == 't') ? 4 : 5;
+		return;
+	}
+	if(strncmp(Json_Pos, "null", 4) == 0)
+	{
+		Json_Pos += 4;
+		return;
+	}
+	v.Kind = Json::Num;
+	v.Value = strtod(Json_Pos, &end);
+	if(end == Json_Pos)
+	{
+		Json_Fail("syntax error");
+	}
+	Json_Pos = end;
+}
+
+/*****************************************************
+* 数据点
+******************************************************/
+struct Gen_Attr
+{
+	int				Id;
+	std::string		Name;
+	std::string		Display;
+	std::string		Type;		//status_writable / status_readonly / alert / fault
+	std::string		DataType;	//bool / enum / uint8 / uint16 / uint32
+	std::vector<std::string> Enum;
+	int				Writable;
+	int				IsBits;		//按位存放
+	int				Byte;		//字节偏移
+	int				Shift;		//IsBits 时的起始位
+	int				Len;		//IsBits 时为位数，否则为字节数
+	uint32_t		Min;
+	uint32_t		Max;
+	double			Ratio;
+	long			Addition;
+};
+
+static std::vector<Gen_Attr> Gen_Attrs;
+static int Gen_ReadLen = 0;
+static int Gen_WriteLen = 0;		//可写区的长度
+static int Gen_WriteNum = 0;		//可写数据点个数
+static int Gen_FlagLen = 0;
+
+static double Gen_Number(const Json *v, const char *Name, const char *Field)
+{
+	if(v == NULL || v->Kind != Json::Num)
+	{
+		fprintf(stderr, "%s: %s: missing number '%s'\n", Gen_Path, Name, Field);
+		exit(1);
+	}
+	return v->Value;
+}
+
+static std::string Gen_Text(const Json &Attr, const char *Field)
+{
+	const Json *v = Attr.Get(Field);
+
+	return (v != NULL && v->Kind == Json::Str) ? v->Text : std::string();
+}
+
+static int Gen_BitsFor(uint32_t Max)
+{
+	int n = 1;
+
+	while((1u << n) <= Max)
+	{
+		n++;
+	}
+	return n;
+}
+
+static void Gen_Load(const Json &Root)
+{
+	const Json *entities = Root.Get("entities");
+	const Json *attrs;
+	const Json *pos;
+	const Json *spec;
+	const Json *e;
+	Gen_Attr a;
+	size_t i, k;
+	int size;
+
+	if(entities == NULL || entities->Kind != Json::Arr || entities->Item.empty()
+		|| (attrs = entities->Item[0].Get("attrs")) == NULL || attrs->Kind != Json::Arr)
+	{
+		Gen_Fail("%s", "no entities[0].attrs");
+	}
+	for(i = 0; i < attrs->Item.size(); i++)
+	{
+		const Json &j = attrs->Item[i];
+
+		a = Gen_Attr();
+		a.Name = Gen_Text(j, "name");
+		a.Display = Gen_Text(j, "display_name");
+		a.Type = Gen_Text(j, "type");
+		a.DataType = Gen_Text(j, "data_type");
+		a.Id = (int)Gen_Number(j.Get("id"), a.Name.c_str(), "id");
+		a.Writable = (a.Type == "status_writable");
+		a.Ratio = 1;
+		a.Byte = -1;
+		if(a.Name.empty())
+		{
+			Gen_Fail("%s", "attr without name");
+		}
+		if(a.Type != "status_writable" && a.Type != "status_readonly" && a.Type != "alert" && a.Type != "fault")
+		{
+			Gen_Fail("unsupported type of %s", a.Name.c_str());
+		}
+
+		size = 0;
+		if(a.DataType == "bool")
+		{
+			a.IsBits = 1;
+			a.Max = 1;
+		}
+		else if(a.DataType == "enum")
+		{
+			e = j.Get("enum");
+			if(e == NULL || e->Kind != Json::Arr || e->Item.empty())
+			{
+				Gen_Fail("enum %s has no values", a.Name.c_str());
+			}
+			for(k = 0; k < e->Item.size(); k++)
+			{
+				a.Enum.push_back(e->Item[k].Text);
+			}
+			a.IsBits = 1;
+			a.Max = (uint32_t)a.Enum.size() - 1;
+		}
+		else if(a.DataType == "uint8" || a.DataType == "uint16" || a.DataType == "uint32")
+		{
+			size = atoi(a.DataType.c_str() + 4) / 8;
+			spec = j.Get("uint_spec");
+			if(spec == NULL)
+			{
+				Gen_Fail("%s has no uint_spec", a.Name.c_str());
+			}
+			a.Min = (uint32_t)Gen_Number(spec->Get("min"), a.Name.c_str(), "min");
+			a.Max = (uint32_t)Gen_Number(spec->Get("max"), a.Name.c_str(), "max");
+			if(spec->Get("ratio") != NULL)
+			{
+				a.Ratio = Gen_Number(spec->Get("ratio"), a.Name.c_str(), "ratio");
+			}
+			if(spec->Get("addition") != NULL)
+			{
+				a.Addition = (long)Gen_Number(spec->Get("addition"), a.Name.c_str(), "addition");
+			}
+			if(a.Min > a.Max || (size < 4 && a.Max >= (1u << (8 * size))))
+			{
+				Gen_Fail("range of %s does not fit its data_type", a.Name.c_str());
+			}
+			a.Len = size;
+		}
+		else
+		{
+			Gen_Fail("unsupported data_type of %s (binary data points are not supported)", a.Name.c_str());
+		}
+		if(a.IsBits)
+		{
+			a.Len = Gen_BitsFor(a.Max);
+		}
+
+		pos = j.Get("position");
+		if(pos != NULL)
+		{
+			a.Byte = (int)Gen_Number(pos->Get("byte_offset"), a.Name.c_str(), "byte_offset");
+			if(Gen_Text(*pos, "unit") == "bit")
+			{
+				if(a.IsBits == 0)
+				{
+					Gen_Fail("%s: numbers must be stored in whole bytes", a.Name.c_str());
+				}
+				a.Shift = (int)Gen_Number(pos->Get("bit_offset"), a.Name.c_str(), "bit_offset");
+				if((int)Gen_Number(pos->Get("len"), a.Name.c_str(), "len") < a.Len)
+				{
+					Gen_Fail("%s: position.len too short for its values", a.Name.c_str());
+				}
+				a.Len = (int)Gen_Number(pos->Get("len"), a.Name.c_str(), "len");
+			}
+			else if(a.IsBits)
+			{
+				//整字节存放的布尔/枚举：当作占满8位的位字段
+				if((int)Gen_Number(pos->Get("len"), a.Name.c_str(), "len") != 1)
+				{
+					Gen_Fail("%s: byte-stored bool/enum must be 1 byte", a.Name.c_str());
+				}
+				a.Shift = 0;
+				a.Len = 8;
+			}
+			else if((int)Gen_Number(pos->Get("len"), a.Name.c_str(), "len") != size)
+			{
+				Gen_Fail("%s: position.len does not match data_type", a.Name.c_str());
+			}
+			if(a.Byte < 0 || (a.IsBits && a.Shift + a.Len > 8))
+			{
+				Gen_Fail("%s: bit field crosses a byte boundary", a.Name.c_str());
+			}
+		}
+		Gen_Attrs.push_back(a);
+	}
+
+	for(i = 1; i < Gen_Attrs.size(); i++)
+	{
+		if(Gen_Attrs[i].Id <= Gen_Attrs[i - 1].Id)
+		{
+			Gen_Fail("attrs must be listed by increasing id (at %s)", Gen_Attrs[i].Name.c_str());
+		}
+		if(Gen_Attrs[i].Writable && Gen_Attrs[i - 1].Writable == 0)
+		{
+			Gen_Fail("writable %s after a read-only attr", Gen_Attrs[i].Name.c_str());
+		}
+	}
+}
+
+/*******************************************************************************
+* Function Name  : Gen_Layout
+* Description    : 给没有 position 的数据点分配位置，并检查全部位置没有重叠
+* Input          : None
+* Output         : Gen_Attrs 的 Byte/Shift； Gen_ReadLen/Gen_WriteLen/Gen_FlagLen
+* Return         : None
+* Attention		   : 自动排列时位字段放入当前未满的位字节，可写区结束后另起一字节
+*******************************************************************************/
+static void Gen_Layout(void)
+{
+	std::vector<uint8_t> used;		//每个字节已占用的位
+	std::vector<uint8_t> whole;		//整字节字段占用
+	int next = 0;
+	int open = -1;					//可继续放位字段的字节
+	int open_used = 0;
+	int writable = 1;
+	int b;
+	uint8_t mask;
+	size_t i;
+
+	for(i = 0; i < Gen_Attrs.size(); i++)
+	{
+		Gen_Attr &a = Gen_Attrs[i];
+
+		if(a.Writable == 0 && writable)
+		{
+			writable = 0;
+			open = -1;
+		}
+		if(a.Byte < 0)
+		{
+			if(a.IsBits)
+			{
+				if(open < 0 || open_used + a.Len > 8)
+				{
+					open = next++;
+					open_used = 0;
+				}
+				a.Byte = open;
+				a.Shift = open_used;
+				open_used += a.Len;
+			}
+			else
+			{
+				a.Byte = next;
+				next += a.Len;
+			}
+		}
+		else
+		{
+			next = std::max(next, a.Byte + (a.IsBits ? 1 : a.Len));
+		}
+	}
+
+	for(i = 0; i < Gen_Attrs.size(); i++)
+	{
+		const Gen_Attr &a = Gen_Attrs[i];
+
+		if(a.Byte + (a.IsBits ? 1 : a.Len) > (int)used.size())
+		{
+			used.resize(a.Byte + (a.IsBits ? 1 : a.Len), 0);
+			whole.resize(used.size(), 0);
+		}
+		if(a.IsBits)
+		{
+			mask = (uint8_t)(((1u << a.Len) - 1) << a.Shift);
+			if((used[a.Byte] & mask) != 0 || whole[a.Byte])
+			{
+				Gen_Fail("%s overlaps another attr", a.Name.c_str());
+			}
+			used[a.Byte] |= mask;
+		}
+		else
+		{
+			for(b = a.Byte; b < a.Byte + a.Len; b++)
+			{
+				if(used[b] != 0 || whole[b])
+				{
+					Gen_Fail("%s overlaps another attr", a.Name.c_str());
+				}
+				whole[b] = 1;
+			}
+		}
+		if(a.Writable)
+		{
+			Gen_WriteLen = std::max(Gen_WriteLen, a.Byte + (a.IsBits ? 1 : a.Len));
+			Gen_WriteNum++;
+		}
+	}
+	for(i = 0; i < Gen_Attrs.size(); i++)
+	{
+		if(Gen_Attrs[i].Writable == 0 && Gen_Attrs[i].Byte < Gen_WriteLen)
+		{
+			Gen_Fail("%s lies inside the writable section", Gen_Attrs[i].Name.c_str());
+		}
+	}
+	Gen_ReadLen = (int)used.size();
+	Gen_FlagLen = (Gen_WriteNum + 7) / 8;
+	if(Gen_ReadLen == 0 || Gen_ReadLen > 255)
+	{
+		Gen_Fail("%s", "P0 status section must be 1..255 bytes");
+	}
+}
+
+/*****************************************************
+* 输出
+******************************************************/
+static FILE *Out;
+static std::string Prefix;
+
+static const char *Gen_CType(const Gen_Attr &a)
+{
+	return a.Len == 1 ? "uint8_t" : (a.Len == 2 ? "uint16_t" : "uint32_t");
+}
+
+//结构成员：类型后用 Tab 对齐到第24列(Tab 宽4)
+static void Gen_Member(const std::string &Type, const std::string &Name, const std::string &Note)
+{
+	int col = 4 + (int)Type.size();
+
+	fprintf(Out, "\t%s", Type.c_str());
+	do
+	{
+		fputc('\t', Out);
+		col = (col / 4 + 1) * 4;
+	}while(col < 24);
+	fprintf(Out, "%s;", Name.c_str());
+	if(!Note.empty())
+	{
+		fprintf(Out, "\t\t//%s", Note.c_str());
+	}
+	fputc('\n', Out);
+}
+
+//按字节输出 [From, To) 范围内的成员，可写区与控制区共用
+static void Gen_Members(int From, int To)
+{
+	std::string note;
+	char buf[64];
+	size_t i;
+	int b;
+
+	for(b = From; b < To; )
+	{
+		const Gen_Attr *whole = NULL;
+
+		note.clear();
+		for(i = 0; i < Gen_Attrs.size(); i++)
+		{
+			const Gen_Attr &a = Gen_Attrs[i];
+
+			if(a.Byte != b)
+			{
+				continue;
+			}
+			if(a.IsBits == 0)
+			{
+				whole = &a;
+				break;
+			}
+			if(a.Len == 1)
+			{
+				snprintf(buf, sizeof(buf), "%s(%d)", a.Name.c_str(), a.Shift);
+			}
+			else
+			{
+				snprintf(buf, sizeof(buf), "%s(%d-%d)", a.Name.c_str(), a.Shift, a.Shift + a.Len - 1);
+			}
+			note += note.empty() ? "" : ", ";
+			note += buf;
+		}
+		if(whole != NULL)
+		{
+			if(whole->Len == 1)
+			{
+				Gen_Member("uint8_t", whole->Name, "");
+			}
+			else if(whole->Len == 2)
+			{
+				Gen_Member("be16<uint16_t>", whole->Name, "");
+			}
+			else
+			{
+				Gen_Member("uint8_t", whole->Name + "[4]", "大端，用 " + Prefix + "_" + whole->Name + " 读写");
+			}
+			b += whole->Len;
+			continue;
+		}
+		snprintf(buf, sizeof(buf), note.empty() ? "Reserved%d" : "Bits%d", b);
+		Gen_Member("uint8_t", buf, note);
+		b++;
+	}
+}
+
+static void Gen_Field(const Gen_Attr &a)
+{
+	const char *kind = a.Writable ? "可写" : (a.Type == "status_readonly" ? "只读" : (a.Type == "alert" ? "报警" : "故障"));
+	size_t i;
+
+	fprintf(Out, "//%s %s：%s", a.Name.c_str(), a.Display.c_str(), kind);
+	if(a.DataType == "enum")
+	{
+		for(i = 0; i < a.Enum.size(); i++)
+		{
+			fprintf(Out, " %u:%s", (unsigned)i, a.Enum[i].c_str());
+		}
+	}
+	else if(a.IsBits == 0 && (a.Ratio != 1 || a.Addition != 0))
+	{
+		fprintf(Out, "，显示值 = 原始值 * %g + (%ld)", a.Ratio, a.Addition);
+	}
+	fputc('\n', Out);
+
+	if(a.IsBits)
+	{
+		fprintf(Out, "struct %s_%s : Pro_P0Bits<%d, %d, %d, %u> {};\n",
+			Prefix.c_str(), a.Name.c_str(), a.Byte, a.Shift, a.Len, a.Max);
+		return;
+	}
+	fprintf(Out, "struct %s_%s : Pro_P0Value<%d, %s, %u, %u>\n{\n",
+		Prefix.c_str(), a.Name.c_str(), a.Byte, Gen_CType(a), a.Min, a.Max);
+	fprintf(Out, "\tstatic constexpr double\t\tRatio = %g;\n", a.Ratio);
+	fprintf(Out, "\tstatic constexpr int32_t\tAddition = %ld;\n", a.Addition);
+	fprintf(Out, "};\n");
+}
+
+static void Gen_Header(const char *Source, const char *OutName)
+{
+	std::string guard = "_" + std::string(OutName);
+	const char *base = strrchr(Source, '/');
+	size_t i;
+	int id;
+
+	for(i = 0; i < guard.size(); i++)
+	{
+		guard[i] = isalnum((unsigned char)guard[i]) ? toupper((unsigned char)guard[i]) : '_';
+	}
+	base = base ? base + 1 : Source;
+
+	fprintf(Out,
+		"/********************************************************\n"
+		"*\n"
+		"* @file      [%s]\n"
+		"* @author    [True]\n"
+		"* @version   V2.3\n"
+		"* @date      2015-07-06\n"
+		"*\n"
+		"* @brief     机智云 只为智能硬件而生\n"
+		"*            Gizwits Smart Cloud  for Smart Products\n"
+		"*            链接｜增值｜开放｜中立｜安全｜自有｜自由｜生态\n"
+		"*            www.gizwits.com\n"
+		"*\n"
+		"*            由 tools/p0_gen 根据 %s 生成，请修改数据点定义后重新生成\n"
+		"*\n"
+		"*********************************************************/\n"
+		"#ifndef %s\n"
+		"#define %s\n"
+		"\n"
+		"#include \"GizWire.h\"\n"
+		"\n", OutName, base, guard.c_str(), guard.c_str());
+
+	fprintf(Out,
+		"/******************************************************\n"
+		"* 数据点，偏移从状态区(控制区为 Attr_Flags 之后)算起\n"
+		"********************************************************/\n");
+	for(i = 0; i < Gen_Attrs.size(); i++)
+	{
+		Gen_Field(Gen_Attrs[i]);
+	}
+
+	fprintf(Out,
+		"\n"
+		"/******************************************************\n"
+		"* 状态区：设备上报和读取回复的P0数据，共 %d 字节\n"
+		"* 控制区：控制命令的P0数据，%d 字节 Attr_Flags 之后是与状态区相同的可写部分\n"
+		"* BitsN 为按位存放的字节，括号内为其中数据点的起始位\n"
+		"********************************************************/\n"
+		"typedef struct\n{\n", Gen_ReadLen, Gen_FlagLen);
+	Gen_Members(0, Gen_ReadLen);
+	fprintf(Out, "}%s_ReadTypeDef;\n\ntypedef struct\n{\n", Prefix.c_str());
+	Gen_Member("uint8_t", Gen_FlagLen == 1 ? "Attr_Flags" : "Attr_Flags[" + std::to_string(Gen_FlagLen) + "]",
+		"bit n 对应 id 为 n 的可写数据点");
+	Gen_Members(0, Gen_WriteLen);
+	fprintf(Out, "}%s_WriteTypeDef;\n\n", Prefix.c_str());
+	fprintf(Out, "static_assert(sizeof(%s_ReadTypeDef) == %d, \"P0 status layout\");\n", Prefix.c_str(), Gen_ReadLen);
+	fprintf(Out, "static_assert(sizeof(%s_WriteTypeDef) == %d, \"P0 control layout\");\n\n", Prefix.c_str(), Gen_FlagLen + Gen_WriteLen);
+
+	fprintf(Out,
+		"/*******************************************************************************\n"
+		"* Function Name  : %s_Control\n"
+		"* Description    : 按 Attr_Flags 把控制命令中设置的数据点依次交给 H 的同名静态函数\n"
+		"* Input          : W:控制命令的P0数据\n"
+		"* Output         : None\n"
+		"* Return         : None\n"
+		"* Attention\t\t   : 按 id 顺序调用，值已限制在数据点的范围内；H 为每个可写数据点提供\n"
+		"*                  static void 数据点名(类型 Value)，编译时绑定\n"
+		"*******************************************************************************/\n"
+		"template<typename H>\n"
+		"inline void %s_Control(const %s_WriteTypeDef &W)\n"
+		"{\n"
+		"\tconst uint8_t *p = (const uint8_t *)&W + %d;\n\n",
+		Prefix.c_str(), Prefix.c_str(), Prefix.c_str(), Gen_FlagLen);
+	id = 0;
+	for(i = 0; i < Gen_Attrs.size(); i++)
+	{
+		const Gen_Attr &a = Gen_Attrs[i];
+		std::string f = Prefix + "_" + a.Name;
+		char flag[32];
+
+		if(a.Writable == 0)
+		{
+			continue;
+		}
+		if(Gen_FlagLen == 1)
+		{
+			snprintf(flag, sizeof(flag), "W.Attr_Flags");
+		}
+		else
+		{
+			snprintf(flag, sizeof(flag), "W.Attr_Flags[%d]", Gen_FlagLen - 1 - id / 8);
+		}
+		fprintf(Out, "\tif(%s & 0x%02X)\n\t{\n\t\tH::%s(%s::Clamp(%s::Get(p)));\n\t}\n",
+			flag, 1u << (id % 8), a.Name.c_str(), f.c_str(), f.c_str());
+		id++;
+	}
+	fprintf(Out, "}\n\n#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option opts[] =
+	{
+		{ "prefix", required_argument, NULL, 'p' },
+		{ NULL, 0, NULL, 0 }
+	};
+	std::vector<char> src;
+	std::string out_name;
+	Json root;
+	FILE *in;
+	size_t n;
+	char buf[4096];
+	int c;
+
+	while((c = getopt_long(argc, argv, "", opts, NULL)) != -1)
+	{
+		if(c != 'p')
+		{
+			optind = argc;
+			break;
+		}
+		Prefix = optarg;
+	}
+	if(optind != argc - 1 && optind != argc - 2)
+	{
+		fprintf(stderr, "usage: %s [--prefix NAME] product.json [out.h]\n", argv[0]);
+		return 2;
+	}
+	Gen_Path = argv[optind];
+	in = fopen(Gen_Path, "rb");
+	if(in == NULL)
+	{
+		perror(Gen_Path);
+		return 1;
+	}
+	while((n = fread(buf, 1, sizeof(buf), in)) > 0)
+	{
+		src.insert(src.end(), buf, buf + n);
+	}
+	fclose(in);
+	src.push_back(0);
+
+	Json_Src = Json_Pos = &src[0];
+	Json_Parse(root);
+	Json_Space();
+	if(*Json_Pos != 0)
+	{
+		Json_Fail("trailing data");
+	}
+	if(Prefix.empty())
+	{
+		Prefix = Gen_Text(root, "name");
+	}
+	if(Prefix.empty())
+	{
+		Gen_Fail("%s", "no product name; use --prefix");
+	}
+	Gen_Load(root);
+	Gen_Layout();
+
+	if(optind == argc - 2)
+	{
+		out_name = argv[optind + 1];
+		out_name = out_name.substr(out_name.rfind('/') + 1);
+		Out = fopen(argv[optind + 1], "w");
+		if(Out == NULL)
+		{
+			perror(argv[optind + 1]);
+			return 1;
+		}
+	}
+	else
+	{
+		Out = stdout;
+		out_name = Prefix + "_P0.h";
+	}
+	Gen_Header(Gen_Path, out_name.c_str());
+	if(Out != stdout)
+	{
+		fclose(Out);
+	}
+	return 0;
+}
@@ -0,0 +1,300 @@
+/********************************************************
+*
+* @file      [trace_replay.cpp]
+* @author    [True]
+* @version   V2.3
+* @date      2015-07-06
+*
+* @brief     串口收发记录回放(主机)
+*            读取 GizTrace_Dump 导出的记录(可以夹在 mySerial 的调试输出中)，
+*            把其中模组发给MCU的字节按原来的时间送入本机编译的协议栈，
+*            经 Pro_GetFrame/MessageHandle 处理，列出记录中和回放时
+*            MCU发出的帧，并输出解析及ACK统计，用于比较解析器修改前后的表现。
+*            时间为模拟时钟，默认尽快跑完；--speed 1 按原速，--speed 10 为10倍速。
+*
+*            编译：
+*            g++ -O2 -Itools/host -Ilibraries/GizWits -DGIZ_TRACE=0 tools/trace_replay.cpp \
+*                tools/host/GizUart_host.cpp libraries/GizWits/GizWits.cpp \
+*                libraries/GizWits/GizTrace.cpp \
+*                libraries/GizWits/GizLog.cpp -o trace_replay
+*            P0结构长度在编译时给出，默认 -DREPLAY_P0_READ=16 -DREPLAY_P0_WRITE=32
+*            运行：./trace_replay [-v] [--speed N] capture.bin
+*
+*********************************************************/
+#include <GizWitsStack.h>
+#include <GizUart_host.h>
+#include <GizTrace.h>
+#include <HostFrame.h>
+
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_BYTE_MS		1		//记录内相邻字节的间隔，9600波特率下约1ms
+#define REPLAY_TAIL_MS		5000	//记录结束后继续运行的时间，让重发和超时走完
+#ifndef REPLAY_P0_READ
+#define REPLAY_P0_READ		16		//上报P0长度，决定读取回复和上报帧的长度
+#endif
+#ifndef REPLAY_P0_WRITE
+#define REPLAY_P0_WRITE		32		//控制P0长度，决定可接收的最大帧长度
+#endif
+
+SoftwareSerial mySerial(12, 13);
+uint8_t gaterSensorFlag;
+
+typedef struct { uint8_t Byte[REPLAY_P0_READ]; } ReplayReadTypeDef;
+typedef struct { uint8_t Byte[REPLAY_P0_WRITE]; } ReplayWriteTypeDef;
+
+static GizWits<ReplayReadTypeDef, ReplayWriteTypeDef, GizUart_Transport> Replay_Dev;
+
+typedef struct
+{
+	uint32_t				Time;		//记录开始时间(ms)
+	uint8_t					Dir;
+	std::vector<uint8_t>	Data;
+}ReplayRecordTypeDef;
+
+typedef struct
+{
+	uint32_t		Rec_RxBytes;
+	uint32_t		Rec_RxFrames;
+	uint32_t		Rec_TxFrames;
+	uint32_t		Replay_TxFrames;
+	uint32_t		Replay_P0;			//交给应用的P0控制命令
+}ReplayStatTypeDef;
+
+static ReplayStatTypeDef Replay_Stat;
+static uint8_t Replay_Verbose = 0;
+static double Replay_Speed = 0;
+static uint32_t Replay_T0;
+static HostFrame_ParserTypeDef Replay_RxParser, Replay_RecTxParser, Replay_TxParser;
+
+/*******************************************************************************
+* Function Name  : Replay_Load
+* Description    : 在文件中找到第 index 份导出的记录并解析为记录列表
+* Input          : buf/len:文件内容； index:第几份导出(从0开始)
+* Output         : rec:记录
+* Return         : 1:成功； 0:未找到或记录损坏
+* Attention		   : None
+*******************************************************************************/
+static uint8_t Replay_Load(const std::vector<uint8_t> &buf, uint32_t index, std::vector<ReplayRecordTypeDef> &rec)
+{
+	size_t pos;
+	size_t end;
+	uint32_t time = 0;
+	uint32_t delta;
+	uint8_t shift;
+	uint8_t value;
+	uint8_t i;
+
+	for(pos = 0; pos + 10 <= buf.size(); pos++)
+	{
+		if(memcmp(&buf[pos], "GZT1", 4) == 0 && index-- == 0)
+		{
+			break;
+		}
+	}
+	if(pos + 10 > buf.size())
+	{
+		return 0;
+	}
+	for(i = 0; i < 4; i++)
+	{
+		time |= (uint32_t)buf[pos + 4 + i] << (i * 8);
+	}
+	end = pos + 10 + (buf[pos + 8] | (uint16_t)buf[pos + 9] << 8);
+	if(end > buf.size())
+	{
+		fprintf(stderr, "trace truncated: %u of %u bytes\n", (unsigned)(buf.size() - pos - 10), (unsigned)(end - pos - 10));
+		return 0;
+	}
+
+	for(pos += 10; pos < end; )
+	{
+		ReplayRecordTypeDef r;
+		uint8_t head = buf[pos++];
+
+		delta = 0;
+		shift = 0;
+		do
+		{
+			if(pos >= end)
+			{
+				return 0;
+			}
+			value = buf[pos++];
+			delta |= (uint32_t)(value & 0x7F) << shift;
+			shift += 7;
+		}while(value & 0x80);
+		time += delta;
+		r.Time = time;
+		r.Dir = head & GIZ_TRACE_TX;
+		if(pos + (head & 0x7F) > end)
+		{
+			return 0;
+		}
+		r.Data.assign(buf.begin() + pos, buf.begin() + pos + (head & 0x7F));
+		pos += head & 0x7F;
+		rec.push_back(r);
+	}
+	return 1;
+}
+
+static void Replay_Print(const char *who, const uint8_t *f, uint16_t len)
+{
+	uint16_t i;
+
+	if(Replay_Verbose == 0)
+	{
+		return;
+	}
+	printf("%8u ms  %-10s cmd 0x%02X sn %3u len %3u%s ", SystemTimeCount - Replay_T0, who, f[4], f[5], len,
+		HostFrame_SumOk(f, len) ? "" : " BADSUM");
+	for(i = 8; i < len - 1 && i < 24; i++)
+	{
+		printf(" %02X", f[i]);
+	}
+	printf("%s\n", (len - 1 > 24) ? " ..." : "");
+}
+
+static void Replay_Sink(const uint8_t *Buf, uint16_t Len, void *arg)
+{
+	uint16_t i;
+	uint16_t n;
+
+	for(i = 0; i < Len; i++)
+	{
+		if((n = HostFrame_Parse(&Replay_TxParser, Buf[i])) != 0)
+		{
+			Replay_Stat.Replay_TxFrames++;
+			Replay_Print("TX replay", Replay_TxParser.Buf, n);
+		}
+	}
+}
+
+static uint32_t Replay_WallMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+//推进模拟时钟到 target，每毫秒运行一次主循环
+static void Replay_RunUntil(uint32_t target)
+{
+	static uint32_t wall0 = Replay_WallMs();
+	ReplayWriteTypeDef control;
+	uint32_t wall;
+
+	while((int32_t)(target - SystemTimeCount) > 0)
+	{
+		SystemTimeCount++;
+		if(Replay_Dev.MessageHandle(control) == 0)
+		{
+			Replay_Stat.Replay_P0++;
+		}
+		if(Replay_Speed > 0)
+		{
+			wall = wall0 + (uint32_t)((SystemTimeCount - Replay_T0) / Replay_Speed);
+			while((int32_t)(wall - Replay_WallMs()) > 0)
+			{
+				usleep(500);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<uint8_t> file;
+	std::vector<ReplayRecordTypeDef> rec;
+	const Pro_RxStatTypeDef *rxs;
+	const Pro_AckStatTypeDef *ack;
+	const char *path = NULL;
+	uint32_t index = 0;
+	uint8_t tmp[4096];
+	size_t n;
+	size_t i, k;
+	uint16_t len;
+	FILE *fp;
+
+	for(i = 1; i < (size_t)argc; i++)
+	{
+		if(strcmp(argv[i], "-v") == 0)
+			Replay_Verbose = 1;
+		else if(strcmp(argv[i], "--speed") == 0 && i + 1 < (size_t)argc)
+			Replay_Speed = strtod(argv[++i], NULL);
+		else if(strcmp(argv[i], "--dump") == 0 && i + 1 < (size_t)argc)
+			index = strtoul(argv[++i], NULL, 0);
+		else
+			path = argv[i];
+	}
+	if(path == NULL)
+	{
+		fprintf(stderr, "usage: %s [-v] [--speed N] [--dump INDEX] capture.bin\n"
+			"  --speed N    N times real time, 0 = as fast as possible (default)\n"
+			"  --dump INDEX which trace to use when the capture holds several dumps (0)\n", argv[0]);
+		return 2;
+	}
+	if((fp = fopen(path, "rb")) == NULL)
+	{
+		perror(path);
+		return 1;
+	}
+	while((n = fread(tmp, 1, sizeof(tmp), fp)) > 0)
+	{
+		file.insert(file.end(), tmp, tmp + n);
+	}
+	fclose(fp);
+	if(Replay_Load(file, index, rec) == 0 || rec.empty())
+	{
+		fprintf(stderr, "%s: no usable GZT1 trace #%u\n", path, index);
+		return 1;
+	}
+
+	HostUart_SetSink(Replay_Sink, NULL);
+	Replay_Dev.Init();
+	Replay_T0 = rec[0].Time;
+	SystemTimeCount = Replay_T0;
+
+	for(i = 0; i < rec.size(); i++)
+	{
+		Replay_RunUntil(rec[i].Time);
+		for(k = 0; k < rec[i].Data.size(); k++)
+		{
+			if(rec[i].Dir == GIZ_TRACE_TX)
+			{
+				if((len = HostFrame_Parse(&Replay_RecTxParser, rec[i].Data[k])) != 0)
+				{
+					Replay_Stat.Rec_TxFrames++;
+					Replay_Print("TX record", Replay_RecTxParser.Buf, len);
+				}
+				continue;
+			}
+			Replay_Stat.Rec_RxBytes++;
+			if((len = HostFrame_Parse(&Replay_RxParser, rec[i].Data[k])) != 0)
+			{
+				Replay_Stat.Rec_RxFrames++;
+				Replay_Print("RX", Replay_RxParser.Buf, len);
+			}
+			HostUart_Rx(&rec[i].Data[k], 1);
+			Replay_RunUntil(SystemTimeCount + REPLAY_BYTE_MS);
+		}
+	}
+	Replay_RunUntil(SystemTimeCount + REPLAY_TAIL_MS);
+
+	rxs = Replay_Dev.GetRxStat();
+	ack = Replay_Dev.GetAckStat();
+	printf("trace: %u records, %u ms, module->MCU %u bytes / %u frames, recorded MCU->module %u frames\n",
+		(unsigned)rec.size(), rec.back().Time - rec[0].Time, Replay_Stat.Rec_RxBytes,
+		Replay_Stat.Rec_RxFrames, Replay_Stat.Rec_TxFrames);
+	printf("replay: MCU->module %u frames, P0 control to application %u\n",
+		Replay_Stat.Replay_TxFrames, Replay_Stat.Replay_P0);
+	printf("rx: frames %u sum-err %u len-err %u resync %u timeout %u dropped %u overflow %u\n",
+		rxs->Frame_Num, rxs->SumErr_Num, rxs->LenErr_Num, rxs->Resync_Num,
+		rxs->Timeout_Num, rxs->Drop_Num, rxs->Overflow_Num);
+	printf("ack: sent %u resent %u acked %u late %u gave-up %u\n",
+		ack->Send_Num, ack->Resend_Num, ack->Ack_Num, ack->AckLate_Num, ack->GiveUp_Num);
+	return 0;
+}